@@ -3,21 +3,117 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
 #include <CHIP8.h>
 
+static int chip8_step(struct chip8 *chip8);
+static int chip8_run_basic_blocks(struct chip8 *chip8, int instruction_count);
+static bool chip8_skip_idle_instructions(struct chip8 *chip8, uint16_t address, int instruction_count);
+#define CHIP8_DECODE_PAGE_LENGTH 32  // Decode cache entries per page, which covers 64 bytes of memory
+#define CHIP8_DECODE_PAGE_COUNT (4096 / 64)
+
+// Handlers extract their operands from the instruction itself, and the quirk profile selects which variant of a handler is called
+struct chip8_decoded_instruction {
+    uint16_t instruction;
+    uint8_t handler_index;  // The enum chip8_handler of the instruction plus 1, or 0 when the entry hasn't been decoded
+};
+#define CHIP8_HANDLER_INDEX(opcode) (CHIP8_HANDLER_##opcode + 1)
+
+// One entry per even address in the page's 64 bytes of memory. Entries are invalidated when the memory they were decoded from is written to
+struct chip8_decode_page {
+    struct chip8_decoded_instruction instructions[CHIP8_DECODE_PAGE_LENGTH];
+    // For each entry, the amount of instructions left until the end of its compiled basic block, or 0 if it isn't compiled
+    uint8_t basic_block_lengths[CHIP8_DECODE_PAGE_LENGTH];
+};
+
+// Decode pages that nothing was decoded on point to this page, which is never written to
+static const struct chip8_decode_page chip8_empty_decode_page;
+
+static void chip8_invalidate_decoded_instruction(struct chip8 *chip8, uint16_t address);
+static void chip8_invalidate_decode_cache(struct chip8 *chip8);
+static void chip8_reset_state(struct chip8 *chip8);
+static bool chip8_is_decode_page_shared(const struct chip8 *chip8, int page);
+static void chip8_adopt_decode_pages(struct chip8 *chip8);
+static struct chip8_decode_page *chip8_privatize_decode_page(struct chip8 *chip8, int page);
+static void chip8_free_decode_page(struct chip8 *chip8, int page);
+static int chip8_compile_basic_block(struct chip8 *chip8, uint16_t first_index);
+static uint8_t chip8_lookup_handler_index(uint16_t instruction);
+typedef void (*chip8_instruction_handler)(struct chip8 *chip8, uint16_t instruction);
+void chip8_instruction_00EE(struct chip8 *chip8, uint16_t instruction);
+void chip8_instruction_2NNN(struct chip8 *chip8, uint16_t instruction);
+static const chip8_instruction_handler *chip8_get_handler_table(struct chip8 *chip8);
+static int chip8_run_instrumented_instructions(struct chip8 *chip8, int instruction_count);
+static bool chip8_debugger_is_active(const struct chip8_debugger *debugger);
+static void chip8_movie_record(struct chip8_movie *movie, uint16_t keyboard_state);
+static void chip8_call_frame_callbacks(struct chip8 *chip8);
+static void chip8_call_sound_callbacks(struct chip8 *chip8, bool was_sound_playing);
+static int chip8_run_frame(struct chip8 *chip8, int instruction_count);
+static uint16_t chip8_read_instruction(struct chip8 *chip8, uint16_t address);
+
+#ifdef CHIP8_ENABLE_PROFILING
+#include <time.h>
+#define CHIP8_PROFILE_HANDLER(chip8, opcode) ((chip8)->profile.handler_counts[CHIP8_HANDLER_##opcode]++)
+#define CHIP8_PROFILE_ADDRESS(chip8, address) ((chip8)->profile.address_counts[(address) & 0x0FFF]++)
+#define CHIP8_PROFILE_VBLANK_STALL(chip8) ((chip8)->profile.vblank_stall_count++)
+#else
+// Profiling is compiled out unless CHIP8_ENABLE_PROFILING is defined
+#define CHIP8_PROFILE_HANDLER(chip8, opcode) ((void)0)
+#define CHIP8_PROFILE_ADDRESS(chip8, address) ((void)0)
+#define CHIP8_PROFILE_VBLANK_STALL(chip8) ((void)0)
+#endif
+
+#ifdef CHIP8_ENABLE_STATE_HASH
+static void chip8_toggle_memory_hash(struct chip8 *chip8, uint16_t address, int length);
+static void chip8_toggle_screen_hash(struct chip8 *chip8);
+static void chip8_recompute_state_hash(struct chip8 *chip8);
+static inline uint64_t chip8_hash_memory_byte(uint16_t address, uint8_t value);
+static inline uint64_t chip8_hash_screen_row(int row, uint64_t value);
+// Both write hooks must be used before the write, while the previous value is still in place
+#define CHIP8_HASH_MEMORY_WRITE(chip8, address, new_value) \
+    ((chip8)->state_hash ^= chip8_hash_memory_byte((address) & 0x0FFF, (chip8)->memory[(address) & 0x0FFF]) ^ chip8_hash_memory_byte((address) & 0x0FFF, new_value))
+#define CHIP8_HASH_SCREEN_ROW_WRITE(chip8, row, new_row) \
+    ((chip8)->state_hash ^= chip8_hash_screen_row(row, (chip8)->screen_buffer[row]) ^ chip8_hash_screen_row(row, new_row))
+// Bulk writes toggle the hash of the memory or screen they overwrite out of the state hash before writing, and toggle it back in afterwards
+#define CHIP8_HASH_TOGGLE_MEMORY(chip8, address, length) chip8_toggle_memory_hash(chip8, address, length)
+#define CHIP8_HASH_TOGGLE_SCREEN(chip8) chip8_toggle_screen_hash(chip8)
+#define CHIP8_HASH_RECOMPUTE(chip8) chip8_recompute_state_hash(chip8)
+#else
+// State hashing is compiled out unless CHIP8_ENABLE_STATE_HASH is defined
+#define CHIP8_HASH_MEMORY_WRITE(chip8, address, new_value) ((void)0)
+#define CHIP8_HASH_SCREEN_ROW_WRITE(chip8, row, new_row) ((void)0)
+#define CHIP8_HASH_TOGGLE_MEMORY(chip8, address, length) ((void)0)
+#define CHIP8_HASH_TOGGLE_SCREEN(chip8) ((void)0)
+#define CHIP8_HASH_RECOMPUTE(chip8) ((void)0)
+#endif
+
 void chip8_reset(struct chip8 *chip8)
 {
+    chip8_invalidate_decode_cache(chip8);
+    chip8_reset_state(chip8);
+}
+
+static void chip8_reset_state(struct chip8 *chip8)
+{
+    // Resets everything but the decode cache, which must be invalidated or shared with an image afterwards
     memset(chip8->memory, 0x00, sizeof(chip8->memory) / sizeof(*chip8->memory));
-    memset(chip8->keyboard_state, 0, sizeof(chip8->keyboard_state) / sizeof(*chip8->keyboard_state));
-    memset(chip8->screen_buffer, 0x00, sizeof(chip8->screen_buffer) / sizeof(*chip8->screen_buffer));
+    chip8->keyboard_state = 0;
+    chip8->last_frame_keyboard_state = 0;
+    memset(chip8->screen_buffer, 0x00, sizeof(chip8->screen_buffer));
+    chip8->dirty_rows = 0;
+    chip8->is_idle = false;
+    chip8->skipped_instruction_count = 0;
+    chip8->is_frame_interrupted = false;
+    chip8->program_size = 0;
     memset(chip8->registers, 0x00, sizeof(chip8->registers) / sizeof(*chip8->registers));
-    memset(chip8->stack, 0x0000, sizeof(chip8->stack) / sizeof(*chip8->stack));
-    chip8->stack_pointer = 0x0000;
+    memset(chip8->stack, 0x0000, sizeof(chip8->stack));
+    chip8->stack_pointer = 0;
     chip8->current_instruction = 0x0000;
     chip8->program_counter = 0x0200;
     chip8->index_register = 0x0000;
     chip8->delay_timer = 0;
     chip8->sound_timer = 0;
+    chip8_seed_random(chip8, chip8->random_seed);
 
     uint8_t font_data[80] = {
         0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
@@ -40,6 +136,7 @@ void chip8_reset(struct chip8 *chip8)
     for (int i = 0; i < sizeof(font_data) / sizeof(*font_data); i++) {
         chip8->memory[i] = font_data[i];
     }
+    CHIP8_HASH_RECOMPUTE(chip8);
 }
 
 int chip8_load_program(struct chip8 *chip8, const char *file_path)
@@ -48,115 +145,1749 @@ int chip8_load_program(struct chip8 *chip8, const char *file_path)
     if (file == NULL) {
         return 0;
     }
-    unsigned char byte_buffer;
-    int bytes_of_memory = sizeof(chip8->memory) / sizeof(*chip8->memory);
-    for (int i = 0x200; i < bytes_of_memory; i++) {
-        if (fread(&byte_buffer, sizeof(unsigned char), 1, file) == 0) {
-            break;
-        }
-        chip8->memory[i] = byte_buffer;
-    }
+    // One byte more than fits in memory is read, so that oversized programs are detected
+    uint8_t program[CHIP8_MAXIMUM_PROGRAM_SIZE + 1];
+    size_t program_size = fread(program, 1, sizeof(program), file);
+    bool is_read_successful = !ferror(file);
     fclose(file);
+    if (!is_read_successful) {
+        return 0;
+    }
+
+    return chip8_load_program_from_buffer(chip8, program, program_size);
+}
+
+int chip8_load_program_from_buffer(struct chip8 *chip8, const void *program, size_t program_size)
+{
+    if (program_size > CHIP8_MAXIMUM_PROGRAM_SIZE) {
+        return 0;
+    }
+
+    chip8_adopt_decode_pages(chip8);
+    CHIP8_HASH_TOGGLE_MEMORY(chip8, 0x200, program_size);
+    memcpy(&chip8->memory[0x200], program, program_size);
+    CHIP8_HASH_TOGGLE_MEMORY(chip8, 0x200, program_size);
+    for (size_t offset = 0; offset < program_size; offset += 2) {
+        chip8_invalidate_decoded_instruction(chip8, 0x200 + offset);
+    }
+    chip8->program_size = program_size;
     return 1;
 }
 
+uint16_t chip8_get_program_size(struct chip8 *chip8)
+{
+    return chip8->program_size;
+}
+
 int chip8_set_key_state(struct chip8 *chip8, int key_value, bool new_state)
 {
     if (key_value < 0 | key_value > 0xF) {
         return 0;
     }
 
-    chip8->keyboard_state[key_value] = new_state;
-    return 1;
+    if (new_state) {
+        chip8->keyboard_state |= 1 << key_value;
+    }
+    else {
+        chip8->keyboard_state &= ~(1 << key_value);
+    }
+    return 1;
+}
+
+void chip8_set_keyboard_state(struct chip8 *chip8, uint16_t key_mask)
+{
+    chip8->keyboard_state = key_mask;
+}
+
+#ifdef CHIP8_ENABLE_PROFILING
+static uint64_t chip8_get_profile_time(void)
+{
+    // Returns nanoseconds from an arbitrary starting point. clock() is used before C11, which measures processor time with a coarser resolution
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && defined(TIME_UTC)
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+#else
+    return (uint64_t)clock() * (1000000000 / CLOCKS_PER_SEC);
+#endif
+}
+
+const struct chip8_profile *chip8_get_profile(struct chip8 *chip8)
+{
+    return &chip8->profile;
+}
+
+void chip8_reset_profile(struct chip8 *chip8)
+{
+    memset(&chip8->profile, 0x00, sizeof(chip8->profile));
+}
+
+const char *chip8_get_handler_name(enum chip8_handler handler)
+{
+    static const char *handler_names[CHIP8_HANDLER_COUNT] = {
+#define CHIP8_HANDLER_NAME(opcode) #opcode,
+        CHIP8_HANDLERS(CHIP8_HANDLER_NAME)
+#undef CHIP8_HANDLER_NAME
+    };
+    if (handler < 0 || handler >= CHIP8_HANDLER_COUNT) {
+        return NULL;
+    }
+
+    return handler_names[handler];
+}
+#endif
+
+#ifdef CHIP8_ENABLE_STATE_HASH
+/*
+The state hash is the XOR of a hash of every (address, value) pair in memory and every (row, value) pair of the screen, like a Zobrist hash.
+Instead of a table of random numbers, each pair is hashed by the SplitMix64 finalizer, which would otherwise need a table of 4096 * 256 entries.
+Changing a byte or row XORs the hash of its previous value out and the hash of its new value in, so the hash never has to be recomputed from scratch.
+The registers, stack, timers and keyboard only make up a few dozen bytes, so they are hashed when the hash is read instead of on every change.
+*/
+static inline uint64_t chip8_hash_mix(uint64_t value)
+{
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+    return value ^ (value >> 31);
+}
+
+static inline uint64_t chip8_hash_memory_byte(uint16_t address, uint8_t value)
+{
+    return chip8_hash_mix(((uint64_t)address << 8) | value);
+}
+
+static inline uint64_t chip8_hash_screen_row(int row, uint64_t value)
+{
+    // Rows are offset past the memory pairs, so that a row never hashes like an address
+    return chip8_hash_mix(value ^ chip8_hash_mix(0x100000 + row));
+}
+
+static void chip8_toggle_memory_hash(struct chip8 *chip8, uint16_t address, int length)
+{
+    for (int i = 0; i < length; i++) {
+        uint16_t masked_address = (address + i) & 0x0FFF;
+        chip8->state_hash ^= chip8_hash_memory_byte(masked_address, chip8->memory[masked_address]);
+    }
+}
+
+static void chip8_toggle_screen_hash(struct chip8 *chip8)
+{
+    for (int row = 0; row < 32; row++) {
+        chip8->state_hash ^= chip8_hash_screen_row(row, chip8->screen_buffer[row]);
+    }
+}
+
+static void chip8_recompute_state_hash(struct chip8 *chip8)
+{
+    chip8->state_hash = 0;
+    chip8_toggle_memory_hash(chip8, 0x000, sizeof(chip8->memory));
+    chip8_toggle_screen_hash(chip8);
+}
+
+uint64_t chip8_get_state_hash(struct chip8 *chip8)
+{
+    uint64_t registers[2];
+    uint64_t stack[4];
+    memcpy(registers, chip8->registers, sizeof(registers));
+    memcpy(stack, chip8->stack, sizeof(stack));
+    uint64_t hash = chip8->state_hash;
+    hash = chip8_hash_mix(hash ^ registers[0]);
+    hash = chip8_hash_mix(hash ^ registers[1]);
+    for (int i = 0; i < 4; i++) {
+        hash = chip8_hash_mix(hash ^ stack[i]);
+    }
+    hash = chip8_hash_mix(hash ^ ((uint64_t)chip8->index_register << 48 | (uint64_t)chip8->program_counter << 32 | (uint64_t)chip8->keyboard_state << 16 | chip8->last_frame_keyboard_state));
+    hash = chip8_hash_mix(hash ^ ((uint64_t)chip8->random_state << 32 | (uint32_t)chip8->stack_pointer << 16 | (uint32_t)chip8->delay_timer << 8 | chip8->sound_timer));
+    return hash;
+}
+#endif
+
+int chip8_tick_frame(struct chip8 *chip8)
+{
+    return chip8_run_frame(chip8, chip8->instructions_per_frame);
+}
+
+static int chip8_run_frame(struct chip8 *chip8, int instruction_count)
+{
+#ifdef CHIP8_ENABLE_PROFILING
+    uint64_t start_time = chip8_get_profile_time();
+#endif
+    if (chip8->is_frame_interrupted) {
+        // Finishes the frame that a breakpoint or watchpoint interrupted, instead of starting a new one
+        instruction_count = chip8->interrupted_frame_instruction_count;
+        chip8->is_frame_interrupted = false;
+    }
+    else {
+        chip8_update_timers(chip8);
+        chip8->dirty_rows = 0;
+        chip8->is_idle = false;
+        chip8->skipped_instruction_count = 0;
+        chip8->vblank_state = true;  // Vblank state is true once per frame to accurately emulate the timing of draw instructions
+        if (chip8->movie != NULL) {
+            chip8_movie_record(chip8->movie, chip8->keyboard_state);
+        }
+    }
+
+    chip8_adopt_decode_pages(chip8);
+    int result = 1;
+    if (chip8->trace != NULL || (chip8->debugger != NULL && chip8_debugger_is_active(chip8->debugger))) {
+        result = chip8_run_instrumented_instructions(chip8, instruction_count);
+    }
+    else if (chip8->execution_engine == CHIP8_ENGINE_THREADED) {
+        result = chip8_run_basic_blocks(chip8, instruction_count);
+    }
+    else {
+        for (int i = 0; i < instruction_count; i++) {
+            uint16_t address = chip8->program_counter;
+            if (!chip8_step(chip8)) {
+                result = 0;
+                break;
+            }
+            chip8->vblank_state = false;
+            if ((chip8->program_counter == address || chip8->program_counter + 4 == address) && chip8_skip_idle_instructions(chip8, address, instruction_count - i - 1)) {
+                break;
+            }
+        }
+    }
+    if (result != 1) {
+        if (result == 0 && chip8->callbacks != NULL && chip8->callbacks->on_invalid_instruction != NULL) {
+            // The invalid instruction was fetched, so the program counter is already past it
+            chip8->callbacks->on_invalid_instruction(chip8, (chip8->program_counter - 2) & 0x0FFF, chip8->current_instruction, chip8->callbacks->user_data);
+        }
+        return result;
+    }
+
+    chip8->last_frame_keyboard_state = chip8->keyboard_state;
+    if (chip8->rewind != NULL) {
+        chip8_rewind_record(chip8->rewind, chip8);
+    }
+    if (chip8->callbacks != NULL) {
+        chip8_call_frame_callbacks(chip8);
+    }
+#ifdef CHIP8_ENABLE_PROFILING
+    uint64_t frame_time = chip8_get_profile_time() - start_time;
+    chip8->profile.frame_count++;
+    chip8->profile.total_frame_nanoseconds += frame_time;
+    if (frame_time > chip8->profile.max_frame_nanoseconds) {
+        chip8->profile.max_frame_nanoseconds = frame_time;
+    }
+#endif
+
+    return 1;
+}
+
+int chip8_set_instructions_per_second(struct chip8 *chip8, int amount)
+{
+    if (amount < 0) {
+        return 0;
+    }
+
+    chip8->instructions_per_second = amount;
+    chip8->instruction_budget_remainder = 0;
+    return 1;
+}
+
+void chip8_reset_schedule(struct chip8 *chip8)
+{
+    chip8->is_schedule_started = false;
+}
+
+int chip8_run_until(struct chip8 *chip8, uint64_t target_time, struct chip8_run_report *report)
+{
+    /*
+    Frame N of the timeline starts N / 60 seconds after the first call, computed from the frame number instead of accumulated, so
+    that the timeline never drifts. Every frame whose start time was reached is ticked, at most CHIP8_SCHEDULE_MAXIMUM_BURST_FRAMES per call,
+    and when more than CHIP8_SCHEDULE_MAXIMUM_LAG_FRAMES frames are due, the oldest ones are skipped instead of being caught up on.
+    */
+    if (!chip8->is_schedule_started) {
+        chip8->is_schedule_started = true;
+        chip8->schedule_start_time = target_time;
+        chip8->scheduled_frame_count = 0;
+        chip8->instruction_budget_remainder = 0;
+    }
+
+    struct chip8_run_report run_report = {0};
+    uint64_t elapsed_time = (target_time > chip8->schedule_start_time) ? target_time - chip8->schedule_start_time : 0;
+    uint64_t due_frame_count = elapsed_time / 1000000000 * 60 + elapsed_time % 1000000000 * 60 / 1000000000 + 1;
+    if (due_frame_count > chip8->scheduled_frame_count + CHIP8_SCHEDULE_MAXIMUM_LAG_FRAMES) {
+        uint64_t skipped_frame_count = due_frame_count - chip8->scheduled_frame_count - CHIP8_SCHEDULE_MAXIMUM_BURST_FRAMES;
+        run_report.skipped_frame_count = (skipped_frame_count < INT_MAX) ? skipped_frame_count : INT_MAX;
+        chip8->scheduled_frame_count += skipped_frame_count;
+    }
+
+    int result = 1;
+    uint32_t dirty_rows = 0;
+    while (chip8->scheduled_frame_count < due_frame_count && run_report.frame_count < CHIP8_SCHEDULE_MAXIMUM_BURST_FRAMES) {
+        int instruction_count = chip8->instructions_per_frame;
+        if (chip8->instructions_per_second > 0 && !chip8->is_frame_interrupted) {
+            // The remainder carries the sixtieths of an instruction that didn't fit in previous frames, so the rate is spread evenly
+            int64_t instruction_budget = (int64_t)chip8->instructions_per_second + chip8->instruction_budget_remainder;
+            instruction_count = instruction_budget / 60;
+            chip8->instruction_budget_remainder = instruction_budget % 60;
+        }
+        result = chip8_run_frame(chip8, instruction_count);
+        dirty_rows |= chip8->dirty_rows;
+        if (result != 1) {
+            break;
+        }
+        chip8->scheduled_frame_count++;
+        run_report.frame_count++;
+    }
+    chip8->dirty_rows = dirty_rows;
+
+    if (report != NULL) {
+        *report = run_report;
+    }
+    return result;
+}
+
+void chip8_set_callbacks(struct chip8 *chip8, const struct chip8_callbacks *callbacks)
+{
+    chip8->callbacks = callbacks;
+    chip8->was_waiting_for_key = false;
+}
+
+static void chip8_call_frame_callbacks(struct chip8 *chip8)
+{
+    const struct chip8_callbacks *callbacks = chip8->callbacks;
+    if (chip8->dirty_rows != 0 && callbacks->on_display_changed != NULL) {
+        callbacks->on_display_changed(chip8, chip8->dirty_rows, callbacks->user_data);
+    }
+
+    // FX0A waits by repeating itself, so the program counter is left at the instruction when the frame ends while it waits
+    uint16_t instruction = chip8->current_instruction;
+    bool is_waiting_for_key = (instruction & 0xF0FF) == 0xF00A && chip8_read_instruction(chip8, chip8->program_counter) == instruction;
+    if (is_waiting_for_key && !chip8->was_waiting_for_key && callbacks->on_key_wait != NULL) {
+        callbacks->on_key_wait(chip8, (instruction >> 8) & 0x0F, callbacks->user_data);
+    }
+    chip8->was_waiting_for_key = is_waiting_for_key;
+}
+
+static void chip8_call_sound_callbacks(struct chip8 *chip8, bool was_sound_playing)
+{
+    bool is_sound_playing = chip8->sound_timer > 0;
+    if (is_sound_playing && !was_sound_playing && chip8->callbacks->on_sound_start != NULL) {
+        chip8->callbacks->on_sound_start(chip8, chip8->callbacks->user_data);
+    }
+    else if (!is_sound_playing && was_sound_playing && chip8->callbacks->on_sound_stop != NULL) {
+        chip8->callbacks->on_sound_stop(chip8, chip8->callbacks->user_data);
+    }
+}
+
+bool chip8_get_pixel(struct chip8 *chip8, int x, int y)
+{
+    if (x < 0 | x >= chip8->screen_width | y < 0 | y >= chip8->screen_height) {
+        return false;
+    }
+
+    return (chip8->screen_buffer[y] >> (63 - x)) & 1;
+}
+
+const uint64_t *chip8_get_screen_rows(struct chip8 *chip8)
+{
+    return chip8->screen_buffer;
+}
+
+uint32_t chip8_get_dirty_rows(struct chip8 *chip8)
+{
+    return chip8->dirty_rows;
+}
+
+bool chip8_has_screen_changed(struct chip8 *chip8)
+{
+    return chip8->dirty_rows != 0;
+}
+
+int chip8_export_screen(struct chip8 *chip8, void *buffer, enum chip8_pixel_format pixel_format, uint32_t row_mask)
+{
+    int bytes_per_row = 0;
+    switch (pixel_format) {
+        case CHIP8_PIXEL_FORMAT_1BPP:
+            bytes_per_row = 64 / 8;
+            break;
+        case CHIP8_PIXEL_FORMAT_8BPP:
+            bytes_per_row = 64;
+            break;
+        case CHIP8_PIXEL_FORMAT_RGBA32:
+            bytes_per_row = 64 * 4;
+            break;
+        default:
+            return 0;
+    }
+
+    int rows_written = 0;
+    for (int y = 0; y < 32; y++) {
+        if (!((row_mask >> y) & 1)) {
+            continue;
+        }
+
+        uint64_t row = chip8->screen_buffer[y];
+        uint8_t *row_bytes = (uint8_t *)buffer + (y * bytes_per_row);
+        switch (pixel_format) {
+            case CHIP8_PIXEL_FORMAT_1BPP:
+                for (int i = 0; i < 8; i++) {
+                    row_bytes[i] = row >> (56 - (i * 8));
+                }
+                break;
+            case CHIP8_PIXEL_FORMAT_8BPP:
+                for (int x = 0; x < 64; x++) {
+                    row_bytes[x] = ((row >> (63 - x)) & 1) ? 0xFF : 0x00;
+                }
+                break;
+            case CHIP8_PIXEL_FORMAT_RGBA32:
+                for (int x = 0; x < 64; x++) {
+                    uint8_t color = ((row >> (63 - x)) & 1) ? 0xFF : 0x00;
+                    row_bytes[(x * 4)] = color;
+                    row_bytes[(x * 4) + 1] = color;
+                    row_bytes[(x * 4) + 2] = color;
+                    row_bytes[(x * 4) + 3] = 0xFF;
+                }
+                break;
+        }
+        rows_written++;
+    }
+    return rows_written;
+}
+
+int chip8_get_screen_width(struct chip8 *chip8)
+{
+    return chip8->screen_width;
+}
+
+int chip8_get_screen_height(struct chip8 *chip8)
+{
+    return chip8->screen_height;
+}
+
+bool chip8_is_idle(struct chip8 *chip8)
+{
+    return chip8->is_idle;
+}
+
+int chip8_get_skipped_instruction_count(struct chip8 *chip8)
+{
+    return chip8->skipped_instruction_count;
+}
+
+bool chip8_should_sound_play(struct chip8 *chip8)
+{
+    return (chip8->sound_timer > 0);
+}
+
+void chip8_seed_random(struct chip8 *chip8, uint32_t seed)
+{
+    // The xorshift generator's state must never be 0, so the seed is mixed with a constant and the one seed that would produce 0 is remapped
+    chip8->random_seed = seed;
+    chip8->random_state = seed ^ 0x6D2B79F5;
+    if (chip8->random_state == 0) {
+        chip8->random_state = 0x6D2B79F5;
+    }
+}
+
+static uint32_t chip8_next_random(struct chip8 *chip8)
+{
+    // 32-bit xorshift generator
+    uint32_t random_state = chip8->random_state;
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    chip8->random_state = random_state;
+    return random_state;
+}
+
+int chip8_set_instructions_per_frame(struct chip8 *chip8, int amount)
+{
+    if (amount < 0) {
+        return 0;
+    }
+
+    chip8->instructions_per_frame = amount;
+    return 1;
+}
+
+/*
+Save state layout, version 1. Multi-byte values are stored little-endian.
+    Offset  Size  Field
+    0       4     Magic bytes "C8ST"
+    4       2     Version
+    6       2     Reserved, always 0
+    8       4096  memory
+    4104    16    registers
+    4120    2     index_register
+    4122    2     program_counter
+    4124    2     current_instruction
+    4126    32    stack
+    4158    1     stack_pointer
+    4159    1     delay_timer
+    4160    1     sound_timer
+    4161    1     vblank_state
+    4162    2     keyboard_state
+    4164    2     last_frame_keyboard_state
+    4166    256   screen_buffer
+    4422    4     dirty_rows
+    4426    4     random_state
+    4430    4     random_seed
+*/
+#define CHIP8_SAVE_STATE_VERSION 1
+#define CHIP8_SAVE_STATE_SIZE 4434
+
+static uint8_t *chip8_write_bytes(uint8_t *destination, uint64_t value, int byte_count)
+{
+    for (int i = 0; i < byte_count; i++) {
+        destination[i] = value >> (i * 8);
+    }
+    return destination + byte_count;
+}
+
+static const uint8_t *chip8_read_bytes(const uint8_t *source, uint64_t *value, int byte_count)
+{
+    *value = 0;
+    for (int i = 0; i < byte_count; i++) {
+        *value |= (uint64_t)source[i] << (i * 8);
+    }
+    return source + byte_count;
+}
+
+static bool chip8_is_little_endian(void)
+{
+    uint16_t value = 1;
+    uint8_t first_byte;
+    memcpy(&first_byte, &value, 1);
+    return first_byte == 1;
+}
+
+static uint8_t *chip8_write_words(uint8_t *destination, const void *words, int word_size, int word_count)
+{
+    // Arrays of 16-bit or 64-bit words are copied as is on little-endian hosts, and converted one word at a time otherwise
+    if (chip8_is_little_endian()) {
+        memcpy(destination, words, word_size * word_count);
+        return destination + (word_size * word_count);
+    }
+    for (int i = 0; i < word_count; i++) {
+        uint64_t value = (word_size == 2) ? ((const uint16_t *)words)[i] : ((const uint64_t *)words)[i];
+        destination = chip8_write_bytes(destination, value, word_size);
+    }
+    return destination;
+}
+
+static const uint8_t *chip8_read_words(const uint8_t *source, void *words, int word_size, int word_count)
+{
+    if (chip8_is_little_endian()) {
+        memcpy(words, source, word_size * word_count);
+        return source + (word_size * word_count);
+    }
+    for (int i = 0; i < word_count; i++) {
+        uint64_t value;
+        source = chip8_read_bytes(source, &value, word_size);
+        if (word_size == 2) {
+            ((uint16_t *)words)[i] = value;
+        }
+        else {
+            ((uint64_t *)words)[i] = value;
+        }
+    }
+    return source;
+}
+
+static void chip8_copy_memory(struct chip8 *chip8, const uint8_t *source)
+{
+    // Only the decode cache entries whose memory actually changes are invalidated, so that restoring a similar state keeps the cache warm
+    int bytes_of_memory = sizeof(chip8->memory) / sizeof(*chip8->memory);
+    chip8_adopt_decode_pages(chip8);
+    for (int chunk = 0; chunk < bytes_of_memory; chunk += 64) {
+        if (memcmp(&chip8->memory[chunk], &source[chunk], 64) == 0) {
+            continue;
+        }
+        for (int address = chunk; address < chunk + 64; address += 2) {
+            if (chip8->memory[address] != source[address] || chip8->memory[address + 1] != source[address + 1]) {
+                chip8_invalidate_decoded_instruction(chip8, address);
+            }
+        }
+        CHIP8_HASH_TOGGLE_MEMORY(chip8, chunk, 64);
+        memcpy(&chip8->memory[chunk], &source[chunk], 64);
+        CHIP8_HASH_TOGGLE_MEMORY(chip8, chunk, 64);
+    }
+}
+
+size_t chip8_get_save_state_size(void)
+{
+    return CHIP8_SAVE_STATE_SIZE;
+}
+
+int chip8_save_state(struct chip8 *chip8, void *buffer, size_t buffer_size)
+{
+    if (buffer_size < CHIP8_SAVE_STATE_SIZE) {
+        return 0;
+    }
+
+    uint8_t *position = buffer;
+    memcpy(position, "C8ST", 4);
+    position += 4;
+    position = chip8_write_bytes(position, CHIP8_SAVE_STATE_VERSION, 2);
+    position = chip8_write_bytes(position, 0, 2);
+    memcpy(position, chip8->memory, sizeof(chip8->memory));
+    position += sizeof(chip8->memory);
+    memcpy(position, chip8->registers, sizeof(chip8->registers));
+    position += sizeof(chip8->registers);
+    position = chip8_write_bytes(position, chip8->index_register, 2);
+    position = chip8_write_bytes(position, chip8->program_counter, 2);
+    position = chip8_write_bytes(position, chip8->current_instruction, 2);
+    position = chip8_write_words(position, chip8->stack, 2, sizeof(chip8->stack) / sizeof(*chip8->stack));
+    position = chip8_write_bytes(position, chip8->stack_pointer, 1);
+    position = chip8_write_bytes(position, chip8->delay_timer, 1);
+    position = chip8_write_bytes(position, chip8->sound_timer, 1);
+    position = chip8_write_bytes(position, chip8->vblank_state, 1);
+    position = chip8_write_bytes(position, chip8->keyboard_state, 2);
+    position = chip8_write_bytes(position, chip8->last_frame_keyboard_state, 2);
+    position = chip8_write_words(position, chip8->screen_buffer, 8, sizeof(chip8->screen_buffer) / sizeof(*chip8->screen_buffer));
+    position = chip8_write_bytes(position, chip8->dirty_rows, 4);
+    position = chip8_write_bytes(position, chip8->random_state, 4);
+    position = chip8_write_bytes(position, chip8->random_seed, 4);
+    return 1;
+}
+
+int chip8_load_state(struct chip8 *chip8, const void *buffer, size_t buffer_size)
+{
+    const uint8_t *position = buffer;
+    uint64_t value;
+    if (buffer_size < CHIP8_SAVE_STATE_SIZE || memcmp(position, "C8ST", 4) != 0) {
+        return 0;
+    }
+    position += 4;
+    position = chip8_read_bytes(position, &value, 2);
+    if (value != CHIP8_SAVE_STATE_VERSION) {
+        return 0;
+    }
+    position += 2;
+
+    chip8_copy_memory(chip8, position);
+    position += sizeof(chip8->memory);
+    memcpy(chip8->registers, position, sizeof(chip8->registers));
+    position += sizeof(chip8->registers);
+    position = chip8_read_bytes(position, &value, 2);
+    chip8->index_register = value;
+    position = chip8_read_bytes(position, &value, 2);
+    chip8->program_counter = value;
+    position = chip8_read_bytes(position, &value, 2);
+    chip8->current_instruction = value;
+    position = chip8_read_words(position, chip8->stack, 2, sizeof(chip8->stack) / sizeof(*chip8->stack));
+    position = chip8_read_bytes(position, &value, 1);
+    chip8->stack_pointer = value;
+    position = chip8_read_bytes(position, &value, 1);
+    chip8->delay_timer = value;
+    position = chip8_read_bytes(position, &value, 1);
+    chip8->sound_timer = value;
+    position = chip8_read_bytes(position, &value, 1);
+    chip8->vblank_state = value != 0;
+    position = chip8_read_bytes(position, &value, 2);
+    chip8->keyboard_state = value;
+    position = chip8_read_bytes(position, &value, 2);
+    chip8->last_frame_keyboard_state = value;
+    chip8->is_frame_interrupted = false;
+    CHIP8_HASH_TOGGLE_SCREEN(chip8);
+    position = chip8_read_words(position, chip8->screen_buffer, 8, sizeof(chip8->screen_buffer) / sizeof(*chip8->screen_buffer));
+    CHIP8_HASH_TOGGLE_SCREEN(chip8);
+    position = chip8_read_bytes(position, &value, 4);
+    chip8->dirty_rows = value;
+    position = chip8_read_bytes(position, &value, 4);
+    chip8->random_state = value;
+    position = chip8_read_bytes(position, &value, 4);
+    chip8->random_seed = value;
+    return 1;
+}
+
+void chip8_clone(struct chip8 *destination, const struct chip8 *source)
+{
+    enum chip8_quirk_profile destination_quirk_profile = destination->quirk_profile;
+    chip8_adopt_decode_pages(destination);
+    // Everything in front of the decode cache is plain state, so it is copied as is. The destination keeps its own decode cache
+    memcpy(destination, source, offsetof(struct chip8, memory));
+    chip8_copy_memory(destination, source->memory);
+    memcpy(destination->screen_buffer, source->screen_buffer, offsetof(struct chip8, decode_pages) - offsetof(struct chip8, screen_buffer));
+#ifdef CHIP8_ENABLE_STATE_HASH
+    destination->state_hash = source->state_hash;  // chip8_copy_memory updated the hash that was copied from the source
+#endif
+    if (destination_quirk_profile != source->quirk_profile) {
+        // Decoded instructions don't depend on the quirk profile, but the compiled basic blocks end where the previous profile ended them
+        chip8_invalidate_decode_cache(destination);
+    }
+
+    // Pages that the source shares with its image hold the image's memory, so the destination can share them as well
+    if (source->image != NULL && destination->image != source->image) {
+        // The pages shared with the destination's previous image are emptied, so that the destination no longer points into that image
+        for (int page = 0; page < CHIP8_DECODE_PAGE_COUNT; page++) {
+            if (chip8_is_decode_page_shared(destination, page)) {
+                chip8_free_decode_page(destination, page);
+            }
+        }
+        destination->image = source->image;
+    }
+    if (destination->image == source->image) {
+        for (int page = 0; page < CHIP8_DECODE_PAGE_COUNT; page++) {
+            if (chip8_is_decode_page_shared(source, page) && !chip8_is_decode_page_shared(destination, page)) {
+                chip8_free_decode_page(destination, page);
+                destination->decode_pages[page] = source->decode_pages[page];
+            }
+        }
+        destination->shared_decode_pages |= source->shared_decode_pages;
+    }
+}
+
+/*
+Program images. An image holds the memory of a freshly loaded program along with its whole decode cache, compiled ahead of time.
+CHIP-8s loaded from an image read the decode cache entries of every page they haven't written to from the image, and only copy a page
+into their own decode cache when they write to it, so that instances running the same program share the code they run.
+*/
+struct chip8_image {
+    uint8_t memory[4096];
+    uint16_t program_size;
+    enum chip8_quirk_profile quirk_profile;
+    struct chip8_decode_page decode_pages[CHIP8_DECODE_PAGE_COUNT];
+};
+
+struct chip8_image *chip8_image_create(const void *program, size_t program_size, enum chip8_quirk_profile quirk_profile)
+{
+    struct chip8_options options = {
+        .instructions_per_frame = 1,
+        .execution_engine = CHIP8_ENGINE_THREADED,
+        .quirk_profile = quirk_profile,
+    };
+    // The CHIP-8 is zero-initialized, so that it can be deinitialized even if it couldn't be initialized
+    struct chip8 *chip8 = calloc(1, sizeof(*chip8));
+    struct chip8_image *image = malloc(sizeof(*image));
+    bool is_successful = chip8 != NULL && image != NULL && chip8_initialize_with_options(chip8, &options) && chip8_load_program_from_buffer(chip8, program, program_size);
+
+    // Every page is compiled, which allocates it unless allocation fails, in which case the page is left empty
+    for (uint16_t index = 0; is_successful && index < CHIP8_DECODE_PAGE_COUNT * CHIP8_DECODE_PAGE_LENGTH; index++) {
+        if (chip8->decode_pages[index / CHIP8_DECODE_PAGE_LENGTH]->basic_block_lengths[index % CHIP8_DECODE_PAGE_LENGTH] == 0) {
+            chip8_compile_basic_block(chip8, index);
+        }
+    }
+    for (int page = 0; is_successful && page < CHIP8_DECODE_PAGE_COUNT; page++) {
+        is_successful = chip8->decode_pages[page] != &chip8_empty_decode_page;
+        if (is_successful) {
+            memcpy(&image->decode_pages[page], chip8->decode_pages[page], sizeof(image->decode_pages[page]));
+        }
+    }
+    if (is_successful) {
+        memcpy(image->memory, chip8->memory, sizeof(image->memory));
+        image->program_size = chip8->program_size;
+        image->quirk_profile = quirk_profile;
+    }
+    if (chip8 != NULL) {
+        chip8_deinitialize(chip8);
+    }
+    free(chip8);
+    if (!is_successful) {
+        free(image);
+        return NULL;
+    }
+    return image;
+}
+
+void chip8_image_destroy(struct chip8_image *image)
+{
+    free(image);
+}
+
+int chip8_load_image(struct chip8 *chip8, struct chip8_image *image)
+{
+    if (chip8->quirk_profile != image->quirk_profile) {
+        return 0;
+    }
+
+    // Every page starts out shared, so the CHIP-8 doesn't decode anything itself until it writes to its code
+    chip8_invalidate_decode_cache(chip8);
+    chip8_reset_state(chip8);
+    memcpy(chip8->memory, image->memory, sizeof(chip8->memory));
+    CHIP8_HASH_RECOMPUTE(chip8);
+    chip8->program_size = image->program_size;
+    chip8->image = image;
+    for (int page = 0; page < CHIP8_DECODE_PAGE_COUNT; page++) {
+        chip8->decode_pages[page] = &image->decode_pages[page];
+    }
+    chip8->shared_decode_pages = UINT64_MAX;
+    return 1;
+}
+
+/*
+Rewind history. Each recorded frame is stored as its save state XORed with the previous frame's save state, or with an empty state for keyframes.
+The XORed state is mostly zeros, so it is encoded as a sequence of (amount of unchanged bytes, amount of changed bytes, changed bytes) runs.
+Frames are stored in order in a circular buffer. The oldest frames are dropped a whole keyframe interval at a time, so the oldest frame is always a keyframe
+*/
+#define CHIP8_REWIND_MINIMUM_UNCHANGED_RUN 4  // Shorter runs of unchanged bytes are kept in the surrounding run of changed bytes
+#define CHIP8_REWIND_MAXIMUM_ENCODED_SIZE (CHIP8_SAVE_STATE_SIZE * 2)
+
+struct chip8_rewind_frame {
+    uint32_t offset;
+    uint16_t size;
+    bool is_keyframe;
+};
+
+struct chip8_rewind {
+    uint8_t *buffer;
+    size_t buffer_size;
+    struct chip8_rewind_frame *frames;  // Circular, starting at first_frame
+    int max_frames;
+    int first_frame;
+    int frame_count;
+    int keyframe_interval;
+    int frames_since_keyframe;  // The amount of frames recorded after the latest keyframe
+    uint8_t *last_state;  // The latest recorded frame, which the next delta is taken against
+    uint8_t *current_state;  // last_state and current_state point into state_buffers, and are swapped after every frame
+    uint8_t state_buffers[2][CHIP8_SAVE_STATE_SIZE];
+    uint8_t encoded_state[CHIP8_REWIND_MAXIMUM_ENCODED_SIZE];
+};
+
+static const uint8_t chip8_rewind_empty_state[CHIP8_SAVE_STATE_SIZE];
+
+static uint8_t *chip8_rewind_write_length(uint8_t *destination, size_t length)
+{
+    // 7 bits per byte, with the most significant bit set on every byte but the last
+    while (length >= 0x80) {
+        *destination++ = (length & 0x7F) | 0x80;
+        length >>= 7;
+    }
+    *destination++ = length;
+    return destination;
+}
+
+static const uint8_t *chip8_rewind_read_length(const uint8_t *source, size_t *length)
+{
+    *length = 0;
+    for (int shift = 0; ; shift += 7) {
+        *length |= (size_t)(*source & 0x7F) << shift;
+        if (!(*source++ & 0x80)) {
+            return source;
+        }
+    }
+}
+
+static size_t chip8_rewind_encode(const uint8_t *state, const uint8_t *base_state, uint8_t *destination)
+{
+    uint8_t *position = destination;
+    size_t index = 0;
+    while (index < CHIP8_SAVE_STATE_SIZE) {
+        size_t unchanged_start = index;
+        while (index + 64 <= CHIP8_SAVE_STATE_SIZE && memcmp(&state[index], &base_state[index], 64) == 0) {
+            index += 64;
+        }
+        while (index + 8 <= CHIP8_SAVE_STATE_SIZE && memcmp(&state[index], &base_state[index], 8) == 0) {
+            index += 8;
+        }
+        while (index < CHIP8_SAVE_STATE_SIZE && state[index] == base_state[index]) {
+            index++;
+        }
+
+        size_t changed_start = index;
+        size_t changed_end = index;
+        while (index < CHIP8_SAVE_STATE_SIZE && index - changed_end < CHIP8_REWIND_MINIMUM_UNCHANGED_RUN) {
+            if (state[index] != base_state[index]) {
+                changed_end = index + 1;
+            }
+            index++;
+        }
+        index = changed_end;
+
+        position = chip8_rewind_write_length(position, changed_start - unchanged_start);
+        position = chip8_rewind_write_length(position, changed_end - changed_start);
+        for (size_t i = changed_start; i < changed_end; i++) {
+            *position++ = state[i] ^ base_state[i];
+        }
+    }
+    return position - destination;
+}
+
+static void chip8_rewind_apply(uint8_t *state, const uint8_t *encoded_state)
+{
+    size_t index = 0;
+    while (index < CHIP8_SAVE_STATE_SIZE) {
+        size_t unchanged_length;
+        size_t changed_length;
+        encoded_state = chip8_rewind_read_length(encoded_state, &unchanged_length);
+        encoded_state = chip8_rewind_read_length(encoded_state, &changed_length);
+        index += unchanged_length;
+        for (size_t i = 0; i < changed_length; i++) {
+            state[index++] ^= *encoded_state++;
+        }
+    }
+}
+
+static struct chip8_rewind_frame *chip8_rewind_get_frame(struct chip8_rewind *rewind, int index)
+{
+    return &rewind->frames[(rewind->first_frame + index) % rewind->max_frames];
+}
+
+static void chip8_rewind_drop_oldest_frames(struct chip8_rewind *rewind)
+{
+    // Drops the oldest keyframe along with the deltas that depend on it
+    do {
+        rewind->first_frame = (rewind->first_frame + 1) % rewind->max_frames;
+        rewind->frame_count--;
+    } while (rewind->frame_count > 0 && !chip8_rewind_get_frame(rewind, 0)->is_keyframe);
+}
+
+static size_t chip8_rewind_allocate(struct chip8_rewind *rewind, size_t size)
+{
+    while (rewind->frame_count == rewind->max_frames) {
+        chip8_rewind_drop_oldest_frames(rewind);
+    }
+    if (rewind->frame_count == 0) {
+        return 0;
+    }
+
+    // The space following the newest frame holds the oldest frames, which are dropped until the new frame fits
+    const struct chip8_rewind_frame *newest_frame = chip8_rewind_get_frame(rewind, rewind->frame_count - 1);
+    size_t offset = newest_frame->offset + newest_frame->size;
+    if (offset + size > rewind->buffer_size) {
+        while (rewind->frame_count > 0 && chip8_rewind_get_frame(rewind, 0)->offset >= offset) {
+            chip8_rewind_drop_oldest_frames(rewind);
+        }
+        offset = 0;
+    }
+    while (rewind->frame_count > 0) {
+        const struct chip8_rewind_frame *oldest_frame = chip8_rewind_get_frame(rewind, 0);
+        if (oldest_frame->offset >= offset + size || oldest_frame->offset + oldest_frame->size <= offset) {
+            break;
+        }
+        chip8_rewind_drop_oldest_frames(rewind);
+    }
+    return offset;
+}
+
+static void chip8_rewind_decode(struct chip8_rewind *rewind, int index, uint8_t *state)
+{
+    int keyframe_index = index;
+    while (!chip8_rewind_get_frame(rewind, keyframe_index)->is_keyframe) {
+        keyframe_index--;
+    }
+
+    memset(state, 0x00, CHIP8_SAVE_STATE_SIZE);
+    for (int i = keyframe_index; i <= index; i++) {
+        chip8_rewind_apply(state, &rewind->buffer[chip8_rewind_get_frame(rewind, i)->offset]);
+    }
+}
+
+struct chip8_rewind *chip8_rewind_create(size_t buffer_size, int max_frames, int keyframe_interval)
+{
+    if (buffer_size < CHIP8_REWIND_MAXIMUM_ENCODED_SIZE || buffer_size > UINT32_MAX || max_frames <= 0 || keyframe_interval <= 0) {
+        return NULL;
+    }
+
+    struct chip8_rewind *rewind = calloc(1, sizeof(*rewind));
+    if (rewind == NULL) {
+        return NULL;
+    }
+    rewind->buffer = malloc(buffer_size);
+    rewind->frames = calloc(max_frames, sizeof(*rewind->frames));
+    if (rewind->buffer == NULL || rewind->frames == NULL) {
+        chip8_rewind_destroy(rewind);
+        return NULL;
+    }
+    rewind->buffer_size = buffer_size;
+    rewind->max_frames = max_frames;
+    rewind->keyframe_interval = keyframe_interval;
+    rewind->last_state = rewind->state_buffers[0];
+    rewind->current_state = rewind->state_buffers[1];
+    return rewind;
+}
+
+void chip8_rewind_destroy(struct chip8_rewind *rewind)
+{
+    if (rewind == NULL) {
+        return;
+    }
+
+    free(rewind->buffer);
+    free(rewind->frames);
+    free(rewind);
+}
+
+void chip8_attach_rewind(struct chip8 *chip8, struct chip8_rewind *rewind)
+{
+    chip8->rewind = rewind;
+}
+
+void chip8_rewind_record(struct chip8_rewind *rewind, struct chip8 *chip8)
+{
+    chip8_save_state(chip8, rewind->current_state, CHIP8_SAVE_STATE_SIZE);
+
+    bool is_keyframe = rewind->frame_count == 0 || rewind->frames_since_keyframe >= rewind->keyframe_interval - 1;
+    size_t size = chip8_rewind_encode(rewind->current_state, is_keyframe ? chip8_rewind_empty_state : rewind->last_state, rewind->encoded_state);
+    size_t offset = chip8_rewind_allocate(rewind, size);
+    if (!is_keyframe && rewind->frame_count == 0) {
+        // Making room dropped the keyframe this delta depends on
+        is_keyframe = true;
+        size = chip8_rewind_encode(rewind->current_state, chip8_rewind_empty_state, rewind->encoded_state);
+        offset = chip8_rewind_allocate(rewind, size);
+    }
+
+    memcpy(&rewind->buffer[offset], rewind->encoded_state, size);
+    struct chip8_rewind_frame *frame = chip8_rewind_get_frame(rewind, rewind->frame_count);
+    frame->offset = offset;
+    frame->size = size;
+    frame->is_keyframe = is_keyframe;
+    rewind->frame_count++;
+    rewind->frames_since_keyframe = is_keyframe ? 0 : rewind->frames_since_keyframe + 1;
+    uint8_t *last_state = rewind->last_state;
+    rewind->last_state = rewind->current_state;
+    rewind->current_state = last_state;
+}
+
+int chip8_rewind_get_frame_count(struct chip8_rewind *rewind)
+{
+    return rewind->frame_count > 0 ? rewind->frame_count - 1 : 0;
+}
+
+int chip8_rewind_step_back(struct chip8_rewind *rewind, struct chip8 *chip8, int frames)
+{
+    if (frames <= 0 || frames > chip8_rewind_get_frame_count(rewind)) {
+        return 0;
+    }
+
+    int index = rewind->frame_count - 1 - frames;
+    chip8_rewind_decode(rewind, index, rewind->last_state);
+    chip8_load_state(chip8, rewind->last_state, CHIP8_SAVE_STATE_SIZE);
+
+    rewind->frame_count = index + 1;
+    rewind->frames_since_keyframe = 0;
+    while (!chip8_rewind_get_frame(rewind, index - rewind->frames_since_keyframe)->is_keyframe) {
+        rewind->frames_since_keyframe++;
+    }
+    return 1;
+}
+
+void chip8_rewind_clear(struct chip8_rewind *rewind)
+{
+    rewind->first_frame = 0;
+    rewind->frame_count = 0;
+    rewind->frames_since_keyframe = 0;
+}
+
+/*
+Execution trace. Every executed instruction appends a fixed-size record to a ring buffer whose size is a power of 2, so that appending a record
+is a single masked store. The ring keeps the latest records, and chip8_trace_save writes them to a file that tools/chip8_trace.c decodes and diffs.
+*/
+#define CHIP8_TRACE_FILE_HEADER_SIZE 16
+
+struct chip8_trace {
+    struct chip8_trace_record *records;
+    uint64_t record_mask;
+    uint64_t record_count;  // Records appended since the trace was created or cleared, including those that were overwritten
+};
+
+struct chip8_trace *chip8_trace_create(int record_count)
+{
+    if (record_count <= 0 || (record_count & (record_count - 1)) != 0) {
+        return NULL;
+    }
+
+    struct chip8_trace *trace = calloc(1, sizeof(*trace));
+    if (trace == NULL) {
+        return NULL;
+    }
+    trace->records = calloc(record_count, sizeof(*trace->records));
+    if (trace->records == NULL) {
+        free(trace);
+        return NULL;
+    }
+    trace->record_mask = record_count - 1;
+    return trace;
+}
+
+void chip8_trace_destroy(struct chip8_trace *trace)
+{
+    if (trace == NULL) {
+        return;
+    }
+
+    free(trace->records);
+    free(trace);
+}
+
+void chip8_attach_trace(struct chip8 *chip8, struct chip8_trace *trace)
+{
+    chip8->trace = trace;
+}
+
+uint64_t chip8_trace_get_record_count(struct chip8_trace *trace)
+{
+    return trace->record_count;
+}
+
+const struct chip8_trace_record *chip8_trace_get_record(struct chip8_trace *trace, uint64_t index)
+{
+    if (index >= trace->record_count || trace->record_count - index > trace->record_mask + 1) {
+        return NULL;
+    }
+
+    return &trace->records[index & trace->record_mask];
+}
+
+void chip8_trace_clear(struct chip8_trace *trace)
+{
+    trace->record_count = 0;
+}
+
+int chip8_trace_save(struct chip8_trace *trace, const char *file_path)
+{
+    FILE *file = fopen(file_path, "wb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    // The header holds the index of the first record in the file, since older records may have been overwritten
+    uint64_t first_index = (trace->record_count > trace->record_mask + 1) ? trace->record_count - (trace->record_mask + 1) : 0;
+    uint8_t header[CHIP8_TRACE_FILE_HEADER_SIZE];
+    memcpy(header, "C8TR", 4);
+    uint8_t *position = chip8_write_bytes(header + 4, CHIP8_TRACE_FILE_VERSION, 2);
+    position = chip8_write_bytes(position, CHIP8_TRACE_RECORD_SIZE, 2);
+    chip8_write_bytes(position, first_index, 8);
+    bool is_written = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (uint64_t index = first_index; index < trace->record_count && is_written; index++) {
+        const struct chip8_trace_record *record = &trace->records[index & trace->record_mask];
+        uint8_t bytes[CHIP8_TRACE_RECORD_SIZE];
+        position = chip8_write_bytes(bytes, record->address, 2);
+        position = chip8_write_bytes(position, record->instruction, 2);
+        position = chip8_write_bytes(position, record->index_register, 2);
+        position = chip8_write_bytes(position, record->register_x, 1);
+        chip8_write_bytes(position, record->register_f, 1);
+        is_written = fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+    }
+    return (fclose(file) == 0) & is_written;
+}
+
+/*
+Breakpoints and watchpoints. The debugger keeps a flag per address in memory, so checking for a breakpoint is a single lookup.
+Breakpoints stop before the instruction at their address is executed, and watchpoints stop after the instruction that wrote to or changed what they watch.
+*/
+#define CHIP8_DEBUGGER_BREAKPOINT 0x01
+#define CHIP8_DEBUGGER_WATCHPOINT 0x02
+
+struct chip8_debugger {
+    uint8_t address_flags[4096];
+    int breakpoint_count;
+    int watched_address_count;
+    uint16_t watched_registers;  // Bit N is set when register N is watched
+    bool is_index_register_watched;
+    bool skips_next_breakpoint;  // Set when stopping at a breakpoint, so that resuming executes the instruction instead of stopping again
+    struct chip8_break last_break;
+};
+
+static bool chip8_debugger_is_active(const struct chip8_debugger *debugger)
+{
+    return debugger->breakpoint_count > 0 || debugger->watched_address_count > 0 || debugger->watched_registers != 0 || debugger->is_index_register_watched;
+}
+
+static int chip8_debugger_find_watched_write(struct chip8 *chip8, struct chip8_debugger *debugger, uint16_t address)
+{
+    // Returns the first watched address the instruction at the given address is about to write to, or -1. Only FX33 and FX55 write to memory
+    uint16_t instruction = chip8_read_instruction(chip8, address);
+    int write_length = 0;
+    if ((instruction & 0xF0FF) == 0xF033) {
+        write_length = 3;
+    }
+    else if ((instruction & 0xF0FF) == 0xF055) {
+        write_length = ((instruction >> 8) & 0x0F) + 1;
+    }
+    for (int i = 0; i < write_length; i++) {
+        uint16_t written_address = (chip8->index_register + i) & 0x0FFF;
+        if (debugger->address_flags[written_address] & CHIP8_DEBUGGER_WATCHPOINT) {
+            return written_address;
+        }
+    }
+    return -1;
+}
+
+static void chip8_debugger_stop(struct chip8_debugger *debugger, enum chip8_break_reason reason, uint16_t address, uint16_t memory_address, uint8_t register_index)
+{
+    debugger->last_break.reason = reason;
+    debugger->last_break.address = address;
+    debugger->last_break.memory_address = memory_address;
+    debugger->last_break.register_index = register_index;
+}
+
+static bool chip8_debugger_check_registers(struct chip8 *chip8, struct chip8_debugger *debugger, uint16_t address, const uint8_t *previous_registers, uint16_t previous_index_register)
+{
+    if (debugger->is_index_register_watched && chip8->index_register != previous_index_register) {
+        chip8_debugger_stop(debugger, CHIP8_BREAK_INDEX_REGISTER_WATCHPOINT, address, 0, 0);
+        return true;
+    }
+    for (int i = 0; i < 16; i++) {
+        if (((debugger->watched_registers >> i) & 1) && chip8->registers[i] != previous_registers[i]) {
+            chip8_debugger_stop(debugger, CHIP8_BREAK_REGISTER_WATCHPOINT, address, 0, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static int chip8_run_instrumented_instructions(struct chip8 *chip8, int instruction_count)
+{
+    /*
+    Runs frames that are traced or debugged on the interpreter, which executes exactly the same instructions as the threaded engine.
+    Frames without a trace or an active debugger never run this loop, so they don't pay for either of them.
+    Idle loops aren't skipped while debugging, since skipping them would also skip the breakpoints and watchpoints in them.
+    */
+    struct chip8_trace *trace = chip8->trace;
+    struct chip8_debugger *debugger = (chip8->debugger != NULL && chip8_debugger_is_active(chip8->debugger)) ? chip8->debugger : NULL;
+    for (int i = 0; i < instruction_count; i++) {
+        uint16_t address = chip8->program_counter;
+        uint8_t previous_registers[16];
+        uint16_t previous_index_register = chip8->index_register;
+        int watched_write_address = -1;
+        if (debugger != NULL) {
+            if ((debugger->address_flags[address & 0x0FFF] & CHIP8_DEBUGGER_BREAKPOINT) && !debugger->skips_next_breakpoint) {
+                chip8_debugger_stop(debugger, CHIP8_BREAK_BREAKPOINT, address, 0, 0);
+                debugger->skips_next_breakpoint = true;
+                chip8->is_frame_interrupted = true;
+                chip8->interrupted_frame_instruction_count = instruction_count - i;
+                return CHIP8_TICK_BREAK;
+            }
+            debugger->skips_next_breakpoint = false;
+            if (debugger->watched_address_count > 0) {
+                watched_write_address = chip8_debugger_find_watched_write(chip8, debugger, address);
+            }
+            memcpy(previous_registers, chip8->registers, sizeof(previous_registers));
+        }
+
+        int result = chip8_step(chip8);
+        if (trace != NULL) {
+            struct chip8_trace_record *record = &trace->records[trace->record_count++ & trace->record_mask];
+            record->address = address;
+            record->instruction = chip8->current_instruction;
+            record->index_register = chip8->index_register;
+            record->register_x = chip8->registers[(chip8->current_instruction >> 8) & 0x0F];
+            record->register_f = chip8->registers[0xF];
+        }
+        if (!result) {
+            return 0;
+        }
+        chip8->vblank_state = false;
+
+        if (debugger != NULL) {
+            bool is_stopped = false;
+            if (watched_write_address >= 0) {
+                chip8_debugger_stop(debugger, CHIP8_BREAK_MEMORY_WATCHPOINT, address, watched_write_address, 0);
+                is_stopped = true;
+            }
+            else {
+                is_stopped = chip8_debugger_check_registers(chip8, debugger, address, previous_registers, previous_index_register);
+            }
+            if (is_stopped) {
+                chip8->is_frame_interrupted = true;
+                chip8->interrupted_frame_instruction_count = instruction_count - i - 1;
+                return CHIP8_TICK_BREAK;
+            }
+        }
+        else if ((chip8->program_counter == address || chip8->program_counter + 4 == address) && chip8_skip_idle_instructions(chip8, address, instruction_count - i - 1)) {
+            break;
+        }
+    }
+    return 1;
+}
+
+struct chip8_debugger *chip8_debugger_create(void)
+{
+    return calloc(1, sizeof(struct chip8_debugger));
+}
+
+void chip8_debugger_destroy(struct chip8_debugger *debugger)
+{
+    free(debugger);
+}
+
+void chip8_attach_debugger(struct chip8 *chip8, struct chip8_debugger *debugger)
+{
+    chip8->debugger = debugger;
+}
+
+static int chip8_debugger_set_address_flags(struct chip8_debugger *debugger, uint16_t address, uint16_t length, uint8_t flag, int *flagged_address_count)
+{
+    if (address > 0x0FFF || length > 0x1000 - address) {
+        return 0;
+    }
+
+    for (int i = address; i < address + length; i++) {
+        if (!(debugger->address_flags[i] & flag)) {
+            debugger->address_flags[i] |= flag;
+            (*flagged_address_count)++;
+        }
+    }
+    return 1;
+}
+
+static int chip8_debugger_clear_address_flags(struct chip8_debugger *debugger, uint16_t address, uint16_t length, uint8_t flag, int *flagged_address_count)
+{
+    if (address > 0x0FFF || length > 0x1000 - address) {
+        return 0;
+    }
+
+    for (int i = address; i < address + length; i++) {
+        if (debugger->address_flags[i] & flag) {
+            debugger->address_flags[i] &= ~flag;
+            (*flagged_address_count)--;
+        }
+    }
+    return 1;
+}
+
+int chip8_debugger_set_breakpoint(struct chip8_debugger *debugger, uint16_t address, bool is_enabled)
+{
+    if (is_enabled) {
+        return chip8_debugger_set_address_flags(debugger, address, 1, CHIP8_DEBUGGER_BREAKPOINT, &debugger->breakpoint_count);
+    }
+    return chip8_debugger_clear_address_flags(debugger, address, 1, CHIP8_DEBUGGER_BREAKPOINT, &debugger->breakpoint_count);
+}
+
+int chip8_debugger_watch_memory(struct chip8_debugger *debugger, uint16_t address, uint16_t length, bool is_enabled)
+{
+    if (is_enabled) {
+        return chip8_debugger_set_address_flags(debugger, address, length, CHIP8_DEBUGGER_WATCHPOINT, &debugger->watched_address_count);
+    }
+    return chip8_debugger_clear_address_flags(debugger, address, length, CHIP8_DEBUGGER_WATCHPOINT, &debugger->watched_address_count);
+}
+
+int chip8_debugger_watch_register(struct chip8_debugger *debugger, int register_index, bool is_enabled)
+{
+    if (register_index < 0 | register_index > 0xF) {
+        return 0;
+    }
+
+    if (is_enabled) {
+        debugger->watched_registers |= 1 << register_index;
+    }
+    else {
+        debugger->watched_registers &= ~(1 << register_index);
+    }
+    return 1;
+}
+
+void chip8_debugger_watch_index_register(struct chip8_debugger *debugger, bool is_enabled)
+{
+    debugger->is_index_register_watched = is_enabled;
+}
+
+void chip8_debugger_clear(struct chip8_debugger *debugger)
+{
+    memset(debugger, 0x00, sizeof(*debugger));
+}
+
+const struct chip8_break *chip8_debugger_get_break(struct chip8_debugger *debugger)
+{
+    return &debugger->last_break;
+}
+
+/*
+Input movies. The emulator is deterministic given its program, its random seed and the keyboard state of every frame, so a movie only
+stores the seed and one 16-bit keyboard mask per frame. Replaying a movie through chip8_run_frames reproduces the recorded session exactly.
+*/
+#define CHIP8_MOVIE_FILE_VERSION 1
+#define CHIP8_MOVIE_FILE_HEADER_SIZE 16
+
+struct chip8_movie {
+    uint16_t *keyboard_states;  // One mask per frame, where bit N is the state of key N
+    int max_frames;
+    int frame_count;
+    int position;  // The frame which the next call to chip8_run_frames replays
+    uint32_t seed;
+};
+
+struct chip8_movie *chip8_movie_create(int max_frames)
+{
+    if (max_frames <= 0) {
+        return NULL;
+    }
+
+    struct chip8_movie *movie = calloc(1, sizeof(*movie));
+    if (movie == NULL) {
+        return NULL;
+    }
+    movie->keyboard_states = calloc(max_frames, sizeof(*movie->keyboard_states));
+    if (movie->keyboard_states == NULL) {
+        free(movie);
+        return NULL;
+    }
+    movie->max_frames = max_frames;
+    return movie;
+}
+
+struct chip8_movie *chip8_movie_load(const char *file_path)
+{
+    FILE *file = fopen(file_path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    uint8_t header[CHIP8_MOVIE_FILE_HEADER_SIZE];
+    uint64_t version = 0;
+    uint64_t seed = 0;
+    uint64_t frame_count = 0;
+    if (fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header, "C8MV", 4) == 0) {
+        chip8_read_bytes(header + 4, &version, 2);
+        chip8_read_bytes(header + 8, &seed, 4);
+        chip8_read_bytes(header + 12, &frame_count, 4);
+    }
+    struct chip8_movie *movie = NULL;
+    if (version == CHIP8_MOVIE_FILE_VERSION && frame_count <= INT_MAX) {
+        movie = chip8_movie_create((frame_count > 0) ? frame_count : 1);
+    }
+    if (movie == NULL) {
+        fclose(file);
+        return NULL;
+    }
+
+    movie->seed = seed;
+    uint8_t bytes[2];
+    while (movie->frame_count < (int)frame_count && fread(bytes, 1, sizeof(bytes), file) == sizeof(bytes)) {
+        uint64_t keyboard_state;
+        chip8_read_bytes(bytes, &keyboard_state, 2);
+        movie->keyboard_states[movie->frame_count++] = keyboard_state;
+    }
+    fclose(file);
+    if (movie->frame_count != (int)frame_count) {
+        chip8_movie_destroy(movie);
+        return NULL;
+    }
+    return movie;
+}
+
+void chip8_movie_destroy(struct chip8_movie *movie)
+{
+    if (movie == NULL) {
+        return;
+    }
+
+    free(movie->keyboard_states);
+    free(movie);
+}
+
+void chip8_attach_movie(struct chip8 *chip8, struct chip8_movie *movie)
+{
+    chip8->movie = movie;
+    if (movie != NULL) {
+        movie->seed = chip8->random_seed;
+    }
+}
+
+int chip8_movie_save(struct chip8_movie *movie, const char *file_path)
+{
+    FILE *file = fopen(file_path, "wb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    uint8_t header[CHIP8_MOVIE_FILE_HEADER_SIZE];
+    memcpy(header, "C8MV", 4);
+    uint8_t *position = chip8_write_bytes(header + 4, CHIP8_MOVIE_FILE_VERSION, 2);
+    position = chip8_write_bytes(position, 0, 2);
+    position = chip8_write_bytes(position, movie->seed, 4);
+    chip8_write_bytes(position, movie->frame_count, 4);
+    bool is_written = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (int frame = 0; frame < movie->frame_count && is_written; frame++) {
+        uint8_t bytes[2];
+        chip8_write_bytes(bytes, movie->keyboard_states[frame], 2);
+        is_written = fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+    }
+    return (fclose(file) == 0) & is_written;
+}
+
+int chip8_movie_get_frame_count(struct chip8_movie *movie)
+{
+    return movie->frame_count;
+}
+
+uint32_t chip8_movie_get_seed(struct chip8_movie *movie)
+{
+    return movie->seed;
+}
+
+int chip8_movie_get_position(struct chip8_movie *movie)
+{
+    return movie->position;
+}
+
+int chip8_movie_seek(struct chip8_movie *movie, int frame)
+{
+    if (frame < 0 || frame > movie->frame_count) {
+        return 0;
+    }
+
+    movie->position = frame;
+    return 1;
+}
+
+void chip8_movie_clear(struct chip8_movie *movie)
+{
+    movie->frame_count = 0;
+    movie->position = 0;
+}
+
+static void chip8_movie_record(struct chip8_movie *movie, uint16_t keyboard_state)
+{
+    if (movie->frame_count < movie->max_frames) {
+        movie->keyboard_states[movie->frame_count++] = keyboard_state;
+    }
+}
+
+int chip8_run_frames(struct chip8 *chip8, struct chip8_movie *movie, int frame_count)
+{
+    for (int frame = 0; frame < frame_count; frame++) {
+        // A frame interrupted by a breakpoint or watchpoint already took its keyboard state from the movie
+        if (movie != NULL && !chip8->is_frame_interrupted) {
+            if (movie->position >= movie->frame_count) {
+                break;
+            }
+            chip8->keyboard_state = movie->keyboard_states[movie->position++];
+        }
+        int result = chip8_tick_frame(chip8);
+        if (result != 1) {
+            return result;
+        }
+    }
+    return 1;
+}
+
+int chip8_disassemble(uint16_t instruction, char *buffer, size_t buffer_size)
+{
+    // Mnemonics follow Cowgod's CHIP-8 technical reference
+    int x = (instruction >> 8) & 0x0F;
+    int y = (instruction >> 4) & 0x0F;
+    int n = instruction & 0x000F;
+    int nn = instruction & 0x00FF;
+    int nnn = instruction & 0x0FFF;
+    static const char *eight_mnemonics[0x10] = {
+        [0x0] = "LD", [0x1] = "OR", [0x2] = "AND", [0x3] = "XOR", [0x4] = "ADD", [0x5] = "SUB", [0x6] = "SHR", [0x7] = "SUBN", [0xE] = "SHL",
+    };
+    static const char *f_formats[0x100] = {
+        [0x07] = "LD V%X, DT", [0x0A] = "LD V%X, K", [0x15] = "LD DT, V%X", [0x18] = "LD ST, V%X", [0x1E] = "ADD I, V%X",
+        [0x29] = "LD F, V%X", [0x33] = "LD B, V%X", [0x55] = "LD [I], V%X", [0x65] = "LD V%X, [I]",
+    };
+
+    bool is_valid = true;
+    switch (instruction >> 12) {
+        case 0x0:
+            if (instruction == 0x00E0) {
+                snprintf(buffer, buffer_size, "CLS");
+            }
+            else if (instruction == 0x00EE) {
+                snprintf(buffer, buffer_size, "RET");
+            }
+            else {
+                is_valid = false;
+            }
+            break;
+        case 0x1:
+            snprintf(buffer, buffer_size, "JP 0x%03X", nnn);
+            break;
+        case 0x2:
+            snprintf(buffer, buffer_size, "CALL 0x%03X", nnn);
+            break;
+        case 0x3:
+            snprintf(buffer, buffer_size, "SE V%X, 0x%02X", x, nn);
+            break;
+        case 0x4:
+            snprintf(buffer, buffer_size, "SNE V%X, 0x%02X", x, nn);
+            break;
+        case 0x5:
+            is_valid = n == 0x0;
+            snprintf(buffer, buffer_size, "SE V%X, V%X", x, y);
+            break;
+        case 0x6:
+            snprintf(buffer, buffer_size, "LD V%X, 0x%02X", x, nn);
+            break;
+        case 0x7:
+            snprintf(buffer, buffer_size, "ADD V%X, 0x%02X", x, nn);
+            break;
+        case 0x8:
+            is_valid = eight_mnemonics[n] != NULL;
+            if (is_valid) {
+                snprintf(buffer, buffer_size, "%s V%X, V%X", eight_mnemonics[n], x, y);
+            }
+            break;
+        case 0x9:
+            is_valid = n == 0x0;
+            snprintf(buffer, buffer_size, "SNE V%X, V%X", x, y);
+            break;
+        case 0xA:
+            snprintf(buffer, buffer_size, "LD I, 0x%03X", nnn);
+            break;
+        case 0xB:
+            snprintf(buffer, buffer_size, "JP V0, 0x%03X", nnn);
+            break;
+        case 0xC:
+            snprintf(buffer, buffer_size, "RND V%X, 0x%02X", x, nn);
+            break;
+        case 0xD:
+            snprintf(buffer, buffer_size, "DRW V%X, V%X, %d", x, y, n);
+            break;
+        case 0xE:
+            if (nn == 0x9E) {
+                snprintf(buffer, buffer_size, "SKP V%X", x);
+            }
+            else if (nn == 0xA1) {
+                snprintf(buffer, buffer_size, "SKNP V%X", x);
+            }
+            else {
+                is_valid = false;
+            }
+            break;
+        case 0xF:
+            is_valid = f_formats[nn] != NULL;
+            if (is_valid) {
+                snprintf(buffer, buffer_size, f_formats[nn], x);
+            }
+            break;
+    }
+
+    if (!is_valid) {
+        snprintf(buffer, buffer_size, "DW 0x%04X", instruction);
+    }
+    return is_valid;
 }
 
-int chip8_tick_frame(struct chip8 *chip8)
+bool chip8_is_instruction_valid(struct chip8 *chip8, uint16_t instruction)
 {
-    chip8_update_timers(chip8);
+    return chip8_lookup_handler_index(instruction) != 0;
+}
 
-    chip8->vblank_state = true;  // Vblank state is true once per frame to accurately emulate the timing of draw instructions
-    for (int i = 0; i < chip8->instructions_per_frame; i++) {
-        chip8_fetch_next_instruction(chip8);
-        if (!chip8_execute_current_instruction(chip8)) {
-            return 0;
-        }
-        chip8->vblank_state = false;
+static bool chip8_decode_instruction(struct chip8 *chip8, uint16_t instruction, struct chip8_decoded_instruction *decoded_instruction)
+{
+    uint8_t handler_index = chip8_lookup_handler_index(instruction);
+    if (handler_index == 0) {
+        return false;
     }
 
-    memcpy(chip8->last_frame_keyboard_state, chip8->keyboard_state, sizeof(chip8->keyboard_state));
-
-    return 1;
+    decoded_instruction->instruction = instruction;
+    decoded_instruction->handler_index = handler_index;
+    return true;
 }
 
-bool *chip8_get_pixel(struct chip8 *chip8, int x, int y)
+static void chip8_invalidate_decoded_instruction(struct chip8 *chip8, uint16_t address)
 {
-    if (x < 0 | x >= chip8->screen_width | y < 0 | y >= chip8->screen_height) {
-        return NULL;
+    /*
+    Each decode cache entry covers the two bytes starting at an even address, so a write to either byte invalidates it.
+    An entry that wasn't decoded can't be part of a compiled basic block either, so writes to data don't copy the page.
+    */
+    uint16_t index = (address & 0x0FFF) >> 1;
+    int page_index = index % CHIP8_DECODE_PAGE_LENGTH;
+    if (chip8->decode_pages[index / CHIP8_DECODE_PAGE_LENGTH]->instructions[page_index].handler_index == 0) {
+        return;
+    }
+    struct chip8_decode_page *decode_page = chip8_privatize_decode_page(chip8, index / CHIP8_DECODE_PAGE_LENGTH);
+    if (decode_page == NULL) {
+        return;
     }
+    decode_page->instructions[page_index].handler_index = 0;
+    decode_page->basic_block_lengths[page_index] = 0;
 
-    return &chip8->screen_buffer[x + (y * chip8->screen_width)];
+    // Compiled basic blocks which run into the invalidated instruction are invalidated as well. Blocks never cross a page
+    while (page_index != 0 && decode_page->basic_block_lengths[page_index - 1] > 1) {
+        page_index--;
+        decode_page->basic_block_lengths[page_index] = 0;
+    }
 }
 
-int chip8_get_screen_width(struct chip8 *chip8)
+static void chip8_invalidate_decode_cache(struct chip8 *chip8)
 {
-    return chip8->screen_width;
+    chip8_adopt_decode_pages(chip8);
+    for (int page = 0; page < CHIP8_DECODE_PAGE_COUNT; page++) {
+        chip8_free_decode_page(chip8, page);
+    }
+    chip8->image = NULL;
 }
 
-int chip8_get_screen_height(struct chip8 *chip8)
+static bool chip8_is_decode_page_shared(const struct chip8 *chip8, int page)
 {
-    return chip8->screen_height;
+    return (chip8->shared_decode_pages >> page) & 1;
 }
 
-bool chip8_should_sound_play(struct chip8 *chip8)
+static void chip8_adopt_decode_pages(struct chip8 *chip8)
 {
-    return (chip8->sound_timer > 0);
+    /*
+    A CHIP-8 that was copied by value points to the private decode pages of the CHIP-8 it was copied from, which that CHIP-8 keeps writing
+    to and eventually frees. The copy drops those pages without touching them, and decodes its own memory into pages of its own instead.
+    Pages shared with the image stay shared, since they belong to the image.
+    */
+    if (chip8->decode_page_owner == chip8) {
+        return;
+    }
+    for (int page = 0; page < CHIP8_DECODE_PAGE_COUNT; page++) {
+        if (!chip8_is_decode_page_shared(chip8, page)) {
+            chip8->decode_pages[page] = &chip8_empty_decode_page;
+        }
+    }
+    chip8->decode_page_owner = chip8;
+    chip8->decode_page_generation++;
 }
 
-int chip8_set_instructions_per_frame(struct chip8 *chip8, int amount)
+static struct chip8_decode_page *chip8_privatize_decode_page(struct chip8 *chip8, int page)
 {
-    if (amount < 0) {
-        return 0;
+    /*
+    Returns the CHIP-8's own copy of a decode page, which is allocated and copied from the empty page or the image's page the first time
+    the page is modified. Returns NULL if the copy couldn't be allocated, in which case the page is left empty, so that its instructions
+    are decoded without being cached until the next attempt succeeds.
+    */
+    const struct chip8_decode_page *decode_page = chip8->decode_pages[page];
+    if (decode_page != &chip8_empty_decode_page && !chip8_is_decode_page_shared(chip8, page)) {
+        return (struct chip8_decode_page *)decode_page;
     }
 
-    chip8->instructions_per_frame = amount;
-    return 1;
+    struct chip8_decode_page *private_decode_page = malloc(sizeof(*private_decode_page));
+    if (private_decode_page == NULL) {
+        chip8_free_decode_page(chip8, page);
+        return NULL;
+    }
+    memcpy(private_decode_page, decode_page, sizeof(*private_decode_page));
+    chip8->decode_pages[page] = private_decode_page;
+    chip8->shared_decode_pages &= ~((uint64_t)1 << page);
+    chip8->decode_page_generation++;
+    return private_decode_page;
 }
 
-bool chip8_is_instruction_valid(struct chip8 *chip8, uint16_t instruction)
+static void chip8_free_decode_page(struct chip8 *chip8, int page)
 {
-    uint8_t instruction_index = 0;
-    void (**instruction_jump_table_pointer)(struct chip8 *chip8) = chip8->instruction_jump_table;
-    int instruction_jump_table_length = 1;
-    uint8_t most_significant_half_byte = instruction >> 12;
-    switch (most_significant_half_byte) {
+    // Frees the CHIP-8's own copy of a decode page, if it has one, and points the page to the empty page
+    const struct chip8_decode_page *decode_page = chip8->decode_pages[page];
+    if (decode_page != &chip8_empty_decode_page && !chip8_is_decode_page_shared(chip8, page)) {
+        free((void *)decode_page);
+    }
+    chip8->decode_pages[page] = &chip8_empty_decode_page;
+    chip8->shared_decode_pages &= ~((uint64_t)1 << page);
+    chip8->decode_page_generation++;
+}
+
+static bool chip8_ends_basic_block(struct chip8 *chip8, uint16_t instruction)
+{
+    /*
+    Basic blocks end at instructions which can change the program counter (jumps, calls, returns, skips, and instructions which wait by
+    repeating themselves), and at instructions which write to memory, since the write might modify instructions later in the block.
+    Only the COSMAC VIP's 00E0 and DXYN wait for vblank, so with the other quirk profiles, code that clears and draws runs in whole blocks.
+    */
+    switch (instruction >> 12) {
         case 0x0:
-            instruction_index = instruction & 0x00FF;
-            instruction_jump_table_pointer = chip8->zero_instruction_jump_table;
-            instruction_jump_table_length = sizeof(chip8->zero_instruction_jump_table) / sizeof(*chip8->zero_instruction_jump_table);
-            break;
-        case 0x8:
-            instruction_index = instruction & 0x000F;
-            instruction_jump_table_pointer = chip8->eight_instruction_jump_table;
-            instruction_jump_table_length = sizeof(chip8->eight_instruction_jump_table) / sizeof(*chip8->eight_instruction_jump_table);
-            break;
+            return instruction != 0x00E0 || chip8->quirk_profile == CHIP8_QUIRKS_VIP;
+        case 0xD:
+            return chip8->quirk_profile == CHIP8_QUIRKS_VIP;
+        case 0x1:
+        case 0x2:
+        case 0x3:
+        case 0x4:
+        case 0x5:
+        case 0x9:
+        case 0xB:
         case 0xE:
-            instruction_index = instruction & 0x00FF;
-            instruction_jump_table_pointer = chip8->e_instruction_jump_table;
-            instruction_jump_table_length = sizeof(chip8->e_instruction_jump_table) / sizeof(*chip8->e_instruction_jump_table);
-            break;
+            return true;
         case 0xF:
-            instruction_index = instruction & 0x00FF;
-            instruction_jump_table_pointer = chip8->f_instruction_jump_table;
-            instruction_jump_table_length = sizeof(chip8->f_instruction_jump_table) / sizeof(*chip8->f_instruction_jump_table);
-            break;
-    }
-    if (instruction_index >= instruction_jump_table_length) {
-        return false;
-    }
-    if (instruction_jump_table_pointer[instruction_index] == NULL) {
-        return false;
+            switch (instruction & 0x00FF) {
+                case 0x0A:
+                case 0x33:
+                case 0x55:
+                    return true;
+            }
+            return false;
     }
-    return true;
+    return false;
 }
 
 void chip8_update_timers(struct chip8 *chip8)
@@ -167,455 +1898,1058 @@ void chip8_update_timers(struct chip8 *chip8)
 
     if (chip8->sound_timer > 0) {
         chip8->sound_timer -= 1;
+        if (chip8->callbacks != NULL) {
+            chip8_call_sound_callbacks(chip8, true);
+        }
     }
 }
 
 void chip8_fetch_next_instruction(struct chip8 *chip8) 
 {
-    chip8->current_instruction = (chip8->memory[chip8->program_counter] << 8) | chip8->memory[chip8->program_counter + 1];
+    chip8->current_instruction = (chip8->memory[chip8->program_counter & 0x0FFF] << 8) | chip8->memory[(chip8->program_counter + 1) & 0x0FFF];
     chip8->program_counter += 2;
 }
 
 int chip8_execute_current_instruction(struct chip8 *chip8)
 {
     /*
-    The instruction jump table is used to efficiently execute the current instruction, by using the most significant half-byte of the 
-    current instruction as the index to run the instruction's correct function. 
-    However, when the most significant half-byte is 0 or 8 in hexadecimal, another function is run which will then run the correct function 
-    by using the least significant half-byte as the index in another instruction jump table. The same also goes for when the most significant 
-    half-byte is F or E, except the least significant byte is used as the index instead.
+    Instructions are decoded by using the most significant half-byte of the instruction as the index in the instruction jump table.
+    However, when the most significant half-byte is 0 or 8 in hexadecimal, the least significant half-byte is used as the index in
+    another instruction jump table instead. The same also goes for when the most significant half-byte is F or E, except the least
+    significant byte is used as the index instead.
     The reason for this is because the CHIP-8 has instructions which are not decoded solely by checking the most significant half-byte.
+    Decoding resolves the index of the instruction's handler, and the quirk profile's variant of the handler is then called.
     */
-    
-    if (!chip8_is_instruction_valid(chip8, chip8->current_instruction)) {
+
+    struct chip8_decoded_instruction decoded_instruction;
+    if (!chip8_decode_instruction(chip8, chip8->current_instruction, &decoded_instruction)) {
         return 0;
     }
 
-    uint8_t most_significant_half_byte = chip8->current_instruction >> 12;
-    chip8->instruction_jump_table[most_significant_half_byte](chip8);
+    chip8_adopt_decode_pages(chip8);  // The instruction may write to memory
+    CHIP8_PROFILE_ADDRESS(chip8, chip8->program_counter - 2);
+    chip8_get_handler_table(chip8)[decoded_instruction.handler_index](chip8, decoded_instruction.instruction);
     return 1;
 }
 
-void chip8_lookup_in_zero_table(struct chip8 *chip8)
+static int chip8_step(struct chip8 *chip8)
 {
-    uint8_t least_significant_byte = chip8->current_instruction & 0x00FF;
-    chip8->zero_instruction_jump_table[least_significant_byte](chip8);
+    /*
+    Fetches and executes the next instruction through the decode cache. The cache holds one decoded instruction for every even address
+    in memory, so the validity check and the jump table lookups only happen the first time an address is executed. Instructions at odd
+    addresses aren't cached and are decoded every time they are executed.
+    */
+
+    uint16_t address = chip8->program_counter;
+    uint16_t index = address >> 1;
+    const struct chip8_decoded_instruction *decoded_instruction = NULL;
+    if ((address & 0xF001) == 0) {
+        decoded_instruction = &chip8->decode_pages[index / CHIP8_DECODE_PAGE_LENGTH]->instructions[index % CHIP8_DECODE_PAGE_LENGTH];
+    }
+
+    struct chip8_decoded_instruction uncached_instruction;
+    if (decoded_instruction == NULL || decoded_instruction->handler_index == 0) {
+        bool is_cacheable = decoded_instruction != NULL;
+        chip8_fetch_next_instruction(chip8);
+        if (!chip8_decode_instruction(chip8, chip8->current_instruction, &uncached_instruction)) {
+            return 0;
+        }
+        decoded_instruction = &uncached_instruction;
+
+        // Shared pages are never written to. The image already decoded every valid instruction, so the others stay uncached
+        if (is_cacheable && !chip8_is_decode_page_shared(chip8, index / CHIP8_DECODE_PAGE_LENGTH)) {
+            struct chip8_decode_page *decode_page = chip8_privatize_decode_page(chip8, index / CHIP8_DECODE_PAGE_LENGTH);
+            if (decode_page != NULL) {
+                decode_page->instructions[index % CHIP8_DECODE_PAGE_LENGTH] = uncached_instruction;
+            }
+        }
+    }
+    else {
+        chip8->current_instruction = decoded_instruction->instruction;
+        chip8->program_counter += 2;
+    }
+
+    CHIP8_PROFILE_ADDRESS(chip8, address);
+    chip8_get_handler_table(chip8)[decoded_instruction->handler_index](chip8, decoded_instruction->instruction);
+    return 1;
 }
 
-void chip8_lookup_in_eight_table(struct chip8 *chip8)
+static uint16_t chip8_read_instruction(struct chip8 *chip8, uint16_t address)
 {
-    uint8_t least_significant_half_byte = chip8->current_instruction & 0x000F;
-    chip8->eight_instruction_jump_table[least_significant_half_byte](chip8);
+    return (chip8->memory[address & 0x0FFF] << 8) | chip8->memory[(address + 1) & 0x0FFF];
 }
 
-void chip8_lookup_in_e_table(struct chip8 *chip8)
+static bool chip8_skip_idle_instructions(struct chip8 *chip8, uint16_t address, int instruction_count)
 {
-    uint8_t least_significant_byte = chip8->current_instruction & 0x00FF;
-    chip8->e_instruction_jump_table[least_significant_byte](chip8);
+    /*
+    Called after the instruction at the given address jumped back to itself or to 2 instructions before itself, with the amount of
+    instructions left in the frame. Returns true and skips the rest of the frame if the program would spend it idle.
+    Vblank and the keyboard and timer states don't change until the next frame, so the following loops repeat until then:
+    - An instruction that leaves the program counter at its own address, such as DXYN and 00E0 waiting for vblank, FX0A waiting for
+      a key, or a jump to itself. Executing it again changes nothing, except for 2NNN and 00EE, which push and pop the stack.
+    - A loop polling the delay timer, made of FX07, then 3XNN or 4XNN comparing register X, then a jump back to FX07. Register X
+      already holds the delay timer, so only the program counter and the current instruction change on each iteration.
+    */
+    uint16_t instruction = chip8->current_instruction;
+    if (chip8->program_counter == address) {
+        if ((instruction & 0xF000) == 0x2000 || instruction == 0x00EE) {
+            return false;
+        }
+        chip8->is_idle = true;
+        chip8->skipped_instruction_count += instruction_count;
+        return true;
+    }
+
+    uint16_t loop_address = chip8->program_counter;
+    uint16_t timer_instruction = chip8_read_instruction(chip8, loop_address);
+    uint16_t skip_instruction = chip8_read_instruction(chip8, loop_address + 2);
+    uint8_t register_index = (timer_instruction >> 8) & 0x0F;
+    if ((instruction & 0xF000) != 0x1000 || (timer_instruction & 0xF0FF) != 0xF007 || ((skip_instruction >> 8) & 0x0F) != register_index) {
+        return false;
+    }
+    if (chip8->registers[register_index] != chip8->delay_timer) {
+        return false;
+    }
+    bool is_equal = chip8->delay_timer == (skip_instruction & 0xFF);
+    if (!(((skip_instruction & 0xF000) == 0x3000 && !is_equal) || ((skip_instruction & 0xF000) == 0x4000 && is_equal))) {
+        return false;
+    }
+
+    // The loop is left at the same point it would have reached by executing the rest of the frame
+    int loop_position = instruction_count % 3;
+    chip8->program_counter = loop_address + (loop_position << 1);
+    if (loop_position != 0) {
+        chip8->current_instruction = chip8_read_instruction(chip8, chip8->program_counter - 2);
+    }
+    chip8->is_idle = true;
+    chip8->skipped_instruction_count += instruction_count;
+    return true;
 }
 
-void chip8_lookup_in_f_table(struct chip8 *chip8)
+static int chip8_compile_basic_block(struct chip8 *chip8, uint16_t first_index)
 {
-    uint8_t least_significant_byte = chip8->current_instruction & 0x00FF;
-    chip8->f_instruction_jump_table[least_significant_byte](chip8);
+    /*
+    Decodes the instructions from the given decode cache index until the end of the basic block, and then stores the amount of instructions
+    left until the end of the block for each of them. The decoded instructions in the decode cache then form the block's threaded code.
+    Compilation stops early when a block that was already compiled is reached, in which case the two blocks are joined.
+    Blocks also end at the end of a page, so that each page of the decode cache can be shared with an image on its own.
+    Returns the length of the compiled block, which is 0 when its first instruction is invalid or the page couldn't be allocated.
+    */
+    struct chip8_decode_page *decode_page = chip8_privatize_decode_page(chip8, first_index / CHIP8_DECODE_PAGE_LENGTH);
+    if (decode_page == NULL) {
+        return 0;
+    }
+    int first_page_index = first_index % CHIP8_DECODE_PAGE_LENGTH;
+    int end_page_index = first_page_index;
+    int following_block_length = 0;
+    while (end_page_index < CHIP8_DECODE_PAGE_LENGTH) {
+        if (decode_page->basic_block_lengths[end_page_index] != 0) {
+            following_block_length = decode_page->basic_block_lengths[end_page_index];
+            break;
+        }
+
+        struct chip8_decoded_instruction *decoded_instruction = &decode_page->instructions[end_page_index];
+        if (decoded_instruction->handler_index == 0) {
+            uint16_t address = (first_index - first_page_index + end_page_index) << 1;
+            uint16_t instruction = (chip8->memory[address] << 8) | chip8->memory[address + 1];
+            if (!chip8_decode_instruction(chip8, instruction, decoded_instruction)) {
+                break;
+            }
+        }
+        end_page_index++;
+        if (chip8_ends_basic_block(chip8, decoded_instruction->instruction)) {
+            break;
+        }
+    }
+
+    for (int page_index = end_page_index; page_index > first_page_index; page_index--) {
+        following_block_length++;
+        decode_page->basic_block_lengths[page_index - 1] = following_block_length;
+    }
+    return decode_page->basic_block_lengths[first_page_index];
 }
 
-void chip8_instruction_00E0(struct chip8 *chip8)
+static int chip8_run_basic_blocks(struct chip8 *chip8, int instruction_count)
 {
-    // Instruction: Clear screen
-    if (!chip8->vblank_state) {
-        chip8->program_counter -= 2;
+    /*
+    Runs the given amount of instructions by executing whole basic blocks at a time. Only the last instruction of a block can read or
+    change the program counter, so the program counter is only updated once per block, right before that instruction is executed.
+    Instructions at odd addresses and invalid instructions are executed through chip8_step instead.
+    */
+    /*
+    The page of the previous block is kept until a block starts on another page or a page is allocated or freed, so that the block length
+    can be read without first loading the page pointer, which would otherwise add a dependent load to every block.
+    */
+    const chip8_instruction_handler *handler_table = chip8_get_handler_table(chip8);
+    const struct chip8_decode_page *decode_page = NULL;
+    int decode_page_number = -1;
+    uint32_t decode_page_generation = 0;
+    while (instruction_count > 0) {
+        uint16_t address = chip8->program_counter;
+        int block_length = 0;
+        const struct chip8_decoded_instruction *threaded_code = NULL;
+        if ((address & 0xF001) == 0) {
+            uint16_t index = address >> 1;
+            int page = index / CHIP8_DECODE_PAGE_LENGTH;
+            if (page != decode_page_number || chip8->decode_page_generation != decode_page_generation) {
+                decode_page = chip8->decode_pages[page];
+                decode_page_number = page;
+                decode_page_generation = chip8->decode_page_generation;
+            }
+            block_length = decode_page->basic_block_lengths[index % CHIP8_DECODE_PAGE_LENGTH];
+            // The image compiled every block ahead of time, so on shared pages, a length of 0 means the instruction is invalid
+            if (block_length == 0 && !chip8_is_decode_page_shared(chip8, page)) {
+                block_length = chip8_compile_basic_block(chip8, index);
+                decode_page = chip8->decode_pages[page];  // Compiling may have allocated the page
+                decode_page_generation = chip8->decode_page_generation;
+            }
+            threaded_code = &decode_page->instructions[index % CHIP8_DECODE_PAGE_LENGTH];
+        }
+
+        if (block_length == 0) {
+            if (!chip8_step(chip8)) {
+                return 0;
+            }
+            chip8->vblank_state = false;
+            instruction_count--;
+            if ((chip8->program_counter == address || chip8->program_counter + 4 == address) && chip8_skip_idle_instructions(chip8, address, instruction_count)) {
+                break;
+            }
+            continue;
+        }
+
+        /*
+        Calls and returns are always blocks of their own, and make up most of the blocks of call-heavy code, where the bookkeeping of
+        longer blocks below costs more than the instructions themselves. They are called directly instead, so that they can be inlined.
+        */
+        if (block_length == 1 && (threaded_code->handler_index == CHIP8_HANDLER_INDEX(2NNN) || threaded_code->handler_index == CHIP8_HANDLER_INDEX(00EE))) {
+            chip8->current_instruction = threaded_code->instruction;
+            chip8->program_counter = address + 2;
+            CHIP8_PROFILE_ADDRESS(chip8, address);
+            if (threaded_code->handler_index == CHIP8_HANDLER_INDEX(2NNN)) {
+                chip8_instruction_2NNN(chip8, threaded_code->instruction);
+            }
+            else {
+                chip8_instruction_00EE(chip8, threaded_code->instruction);
+            }
+            chip8->vblank_state = false;
+            instruction_count--;
+            if ((chip8->program_counter == address || chip8->program_counter + 4 == address) && chip8_skip_idle_instructions(chip8, address, instruction_count)) {
+                break;
+            }
+            continue;
+        }
+
+        if (block_length > instruction_count) {
+            block_length = instruction_count;
+        }
+        const struct chip8_decoded_instruction *last_instruction = &threaded_code[block_length - 1];
+        for (const struct chip8_decoded_instruction *instruction = threaded_code; instruction < last_instruction; instruction++) {
+            CHIP8_PROFILE_ADDRESS(chip8, address + ((instruction - threaded_code) << 1));
+            handler_table[instruction->handler_index](chip8, instruction->instruction);
+        }
+        if (block_length > 1) {
+            chip8->vblank_state = false;
+        }
+        chip8->current_instruction = last_instruction->instruction;
+        chip8->program_counter = address + (block_length << 1);
+        CHIP8_PROFILE_ADDRESS(chip8, address + ((block_length - 1) << 1));
+        handler_table[last_instruction->handler_index](chip8, last_instruction->instruction);
+        chip8->vblank_state = false;
+        instruction_count -= block_length;
+
+        // Only the last instruction of a block can jump, so it is the only one that can start an idle loop
+        uint16_t last_address = address + ((block_length - 1) << 1);
+        if ((chip8->program_counter == last_address || chip8->program_counter + 4 == last_address) && chip8_skip_idle_instructions(chip8, last_address, instruction_count)) {
+            break;
+        }
+    }
+    return 1;
+}
+
+/*
+Static analysis. The code reachable from the program counter is walked through jumps, calls and skips, while tracking the value of the
+index register where it is known, so that the memory written by FX55 and FX33 instructions can be compared against the code.
+Each address is walked again when the index register value reaching it changes, which happens at most twice, since values only change
+from unvisited to known, and from known to unknown.
+*/
+#define CHIP8_ANALYSIS_UNVISITED -2
+#define CHIP8_ANALYSIS_UNKNOWN_INDEX -1
+
+struct chip8_analysis_walk {
+    int32_t index_states[4096];  // The index register value reaching each address, or one of the values above
+    uint16_t worklist[4096];
+    bool is_queued[4096];
+    int worklist_length;
+};
+
+static void chip8_analysis_visit(struct chip8_analysis_walk *walk, uint16_t address, int32_t index_state)
+{
+    address &= 0x0FFF;
+    int32_t previous_index_state = walk->index_states[address];
+    if (previous_index_state != CHIP8_ANALYSIS_UNVISITED && previous_index_state != index_state) {
+        index_state = CHIP8_ANALYSIS_UNKNOWN_INDEX;
+    }
+    if (index_state == previous_index_state) {
         return;
     }
-    memset(&(chip8->screen_buffer), 0x00, chip8->screen_width * chip8->screen_height);
+
+    walk->index_states[address] = index_state;
+    if (!walk->is_queued[address]) {
+        walk->is_queued[address] = true;
+        walk->worklist[walk->worklist_length++] = address;
+    }
+}
+
+static void chip8_analysis_visit_branch(struct chip8_analysis_walk *walk, struct chip8_analysis *analysis, uint16_t address, int32_t index_state)
+{
+    analysis->address_flags[address & 0x0FFF] |= CHIP8_ADDRESS_BRANCH_TARGET;
+    chip8_analysis_visit(walk, address, index_state);
+}
+
+static bool chip8_is_code_byte(const struct chip8_analysis *analysis, uint16_t address)
+{
+    return (analysis->address_flags[address & 0x0FFF] | analysis->address_flags[(address - 1) & 0x0FFF]) & CHIP8_ADDRESS_CODE;
+}
+
+int chip8_analyze_program(struct chip8 *chip8, struct chip8_analysis *analysis)
+{
+    struct chip8_analysis_walk walk;
+    memset(analysis, 0x00, sizeof(*analysis));
+    for (int address = 0; address < 4096; address++) {
+        walk.index_states[address] = CHIP8_ANALYSIS_UNVISITED;
+        walk.is_queued[address] = false;
+    }
+    walk.worklist_length = 0;
+    chip8_analysis_visit(&walk, chip8->program_counter, chip8->index_register);
+
+    while (walk.worklist_length > 0) {
+        uint16_t address = walk.worklist[--walk.worklist_length];
+        walk.is_queued[address] = false;
+        int32_t index_state = walk.index_states[address];
+        uint16_t instruction = chip8_read_instruction(chip8, address);
+        if (chip8_lookup_handler_index(instruction) == 0) {
+            analysis->address_flags[address] |= CHIP8_ADDRESS_INVALID;
+            continue;
+        }
+        analysis->address_flags[address] |= CHIP8_ADDRESS_CODE;
+
+        uint16_t nnn = instruction & 0x0FFF;
+        uint8_t x = (instruction & 0x0F00) >> 8;
+        int32_t next_index_state = index_state;
+        switch (instruction >> 12) {
+            case 0x0:
+                if (instruction == 0x00EE) {
+                    continue;  // Execution continues after the call instead
+                }
+                break;
+            case 0x1:
+                chip8_analysis_visit_branch(&walk, analysis, nnn, index_state);
+                continue;
+            case 0x2:
+                chip8_analysis_visit_branch(&walk, analysis, nnn, index_state);
+                chip8_analysis_visit(&walk, address + 2, CHIP8_ANALYSIS_UNKNOWN_INDEX);  // The subroutine may change the index register
+                continue;
+            case 0x3:
+            case 0x4:
+            case 0x5:
+            case 0x9:
+            case 0xE:
+                chip8_analysis_visit_branch(&walk, analysis, address + 4, index_state);
+                break;
+            case 0xA:
+                next_index_state = nnn;
+                break;
+            case 0xB:
+                analysis->address_flags[address] |= CHIP8_ADDRESS_INDIRECT_JUMP;
+                continue;
+            case 0xF:
+                if ((instruction & 0xFF) == 0x1E || (instruction & 0xFF) == 0x29) {
+                    next_index_state = CHIP8_ANALYSIS_UNKNOWN_INDEX;
+                }
+                else if (((instruction & 0xFF) == 0x55 || (instruction & 0xFF) == 0x65) && index_state >= 0) {
+                    // Matches the index increment of the FX55 and FX65 variants of each quirk profile
+                    int index_increment = x + 1;
+                    if (chip8->quirk_profile == CHIP8_QUIRKS_CHIP48) {
+                        index_increment = x;
+                    }
+                    else if (chip8->quirk_profile == CHIP8_QUIRKS_SUPERCHIP) {
+                        index_increment = 0;
+                    }
+                    next_index_state = (index_state + index_increment) & 0xFFFF;
+                }
+                break;
+        }
+        chip8_analysis_visit(&walk, address + 2, next_index_state);
+    }
+
+    chip8_adopt_decode_pages(chip8);
+    for (int address = 0; address < 4096; address++) {
+        uint8_t flags = analysis->address_flags[address];
+        analysis->invalid_instruction_count += (flags & CHIP8_ADDRESS_INVALID) != 0;
+        analysis->indirect_jump_count += (flags & CHIP8_ADDRESS_INDIRECT_JUMP) != 0;
+        if (!(flags & CHIP8_ADDRESS_CODE)) {
+            continue;
+        }
+        analysis->instruction_count++;
+
+        // Reachable instructions are decoded ahead of time, so that executing them never goes through the decoder. Shared pages already are
+        int page = (address >> 1) / CHIP8_DECODE_PAGE_LENGTH;
+        int page_index = (address >> 1) % CHIP8_DECODE_PAGE_LENGTH;
+        if ((address & 1) == 0 && !chip8_is_decode_page_shared(chip8, page) && chip8->decode_pages[page]->instructions[page_index].handler_index == 0) {
+            struct chip8_decode_page *decode_page = chip8_privatize_decode_page(chip8, page);
+            if (decode_page != NULL) {
+                chip8_decode_instruction(chip8, chip8_read_instruction(chip8, address), &decode_page->instructions[page_index]);
+            }
+        }
+
+        uint16_t instruction = chip8_read_instruction(chip8, address);
+        int write_length = 0;
+        if ((instruction & 0xF0FF) == 0xF055) {
+            write_length = ((instruction & 0x0F00) >> 8) + 1;
+        }
+        else if ((instruction & 0xF0FF) == 0xF033) {
+            write_length = 3;
+        }
+        if (write_length == 0) {
+            continue;
+        }
+        int32_t index_state = walk.index_states[address];
+        bool is_hazard = index_state < 0;
+        for (int i = 0; i < write_length && !is_hazard; i++) {
+            analysis->address_flags[(index_state + i) & 0x0FFF] |= CHIP8_ADDRESS_WRITTEN;
+            is_hazard = chip8_is_code_byte(analysis, index_state + i);
+        }
+        if (is_hazard) {
+            analysis->address_flags[address] |= CHIP8_ADDRESS_SELF_MODIFYING;
+            analysis->self_modification_hazard_count++;
+        }
+    }
+
+    return analysis->invalid_instruction_count == 0 && analysis->indirect_jump_count == 0 && analysis->self_modification_hazard_count == 0;
+}
+
+/*
+Instructions that behave differently between quirk profiles are defined through macros, which are expanded once per variant. Their quirk
+parameters are constants, so each variant is compiled without branching on them. Variants used by the CHIP-48 and SUPER-CHIP profiles
+have the suffix _chip48 or _superchip.
+*/
+#define CHIP8_DEFINE_INSTRUCTION_00E0(name, waits_for_vblank) \
+void name(struct chip8 *chip8, uint16_t instruction) \
+{ \
+    /* Instruction: Clear screen */ \
+    CHIP8_PROFILE_HANDLER(chip8, 00E0); \
+    if ((waits_for_vblank) && !chip8->vblank_state) { \
+        CHIP8_PROFILE_VBLANK_STALL(chip8); \
+        chip8->program_counter -= 2; \
+        return; \
+    } \
+    for (int row = 0; row < 32; row++) { \
+        if (chip8->screen_buffer[row] != 0) { \
+            chip8->dirty_rows |= (uint32_t)1 << row; \
+        } \
+    } \
+    CHIP8_HASH_TOGGLE_SCREEN(chip8); \
+    memset(chip8->screen_buffer, 0x00, sizeof(chip8->screen_buffer)); \
+    CHIP8_HASH_TOGGLE_SCREEN(chip8); \
 }
 
-void chip8_instruction_00EE(struct chip8 *chip8)
+CHIP8_DEFINE_INSTRUCTION_00E0(chip8_instruction_00E0, true)
+CHIP8_DEFINE_INSTRUCTION_00E0(chip8_instruction_00E0_chip48, false)
+
+void chip8_instruction_00EE(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Return from subroutine
-    chip8->program_counter = chip8->stack[chip8->stack_pointer];
-    chip8->stack[chip8->stack_pointer] = 0x0000;
+    CHIP8_PROFILE_HANDLER(chip8, 00EE);
+    chip8->program_counter = chip8->stack[chip8->stack_pointer & 0x0F];
+    chip8->stack[chip8->stack_pointer & 0x0F] = 0x0000;
     chip8->stack_pointer--;
 }
 
-void chip8_instruction_1NNN(struct chip8 *chip8)
+void chip8_instruction_1NNN(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Jump to NNN
-    uint16_t jump_address = chip8->current_instruction & 0x0FFF;
+    CHIP8_PROFILE_HANDLER(chip8, 1NNN);
+    uint16_t jump_address = instruction & 0x0FFF;
     chip8->program_counter = jump_address;
 }
 
-void chip8_instruction_2NNN(struct chip8 *chip8)
+void chip8_instruction_2NNN(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Call subroutine
+    CHIP8_PROFILE_HANDLER(chip8, 2NNN);
     chip8->stack_pointer++;
-    chip8->stack[chip8->stack_pointer] = chip8->program_counter;
-    uint16_t subroutine_address = chip8->current_instruction & 0x0FFF;
+    chip8->stack[chip8->stack_pointer & 0x0F] = chip8->program_counter;
+    uint16_t subroutine_address = instruction & 0x0FFF;
     chip8->program_counter = subroutine_address;
 }
 
-void chip8_instruction_3XNN(struct chip8 *chip8)
+void chip8_instruction_3XNN(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Skip next instruction if register X == NN
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t value_to_compare = chip8->current_instruction & 0x00FF;
+    CHIP8_PROFILE_HANDLER(chip8, 3XNN);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
+    uint8_t value_to_compare = instruction & 0x00FF;
     if (chip8->registers[register_index] == value_to_compare) {
         chip8->program_counter += 2;
     }
 }
 
-void chip8_instruction_4XNN(struct chip8 *chip8)
+void chip8_instruction_4XNN(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Skip next instruction if register X != NN
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t value_to_compare = chip8->current_instruction & 0x00FF;
+    CHIP8_PROFILE_HANDLER(chip8, 4XNN);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
+    uint8_t value_to_compare = instruction & 0x00FF;
     if (chip8->registers[register_index] != value_to_compare) {
         chip8->program_counter += 2;
     }
 }
 
-void chip8_instruction_5XY0(struct chip8 *chip8)
+void chip8_instruction_5XY0(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: If register X == register Y, skip next instruction
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
+    CHIP8_PROFILE_HANDLER(chip8, 5XY0);
+    uint8_t register_x_index = (instruction & 0x0F00) >> 8;
+    uint8_t register_y_index = (instruction & 0x00F0) >> 4;
     if (chip8->registers[register_x_index] == chip8->registers[register_y_index]) {
         chip8->program_counter += 2;
     }
 }
 
-void chip8_instruction_6XNN(struct chip8 *chip8)
+void chip8_instruction_6XNN(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Set register X to NN
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t value_to_set = chip8->current_instruction & 0x00FF;    
+    CHIP8_PROFILE_HANDLER(chip8, 6XNN);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
+    uint8_t value_to_set = instruction & 0x00FF;    
     chip8->registers[register_index] = value_to_set;
 }
 
-void chip8_instruction_7XNN(struct chip8 *chip8)
+void chip8_instruction_7XNN(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Add NN to register X
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t value_to_add = chip8->current_instruction & 0x00FF;
+    CHIP8_PROFILE_HANDLER(chip8, 7XNN);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
+    uint8_t value_to_add = instruction & 0x00FF;
     chip8->registers[register_index] += value_to_add;
 }
 
-void chip8_instruction_8XY0(struct chip8 *chip8)
+void chip8_instruction_8XY0(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Set register X to register Y
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
+    CHIP8_PROFILE_HANDLER(chip8, 8XY0);
+    uint8_t register_x_index = (instruction & 0x0F00) >> 8;
+    uint8_t register_y_index = (instruction & 0x00F0) >> 4;
     chip8->registers[register_x_index] = chip8->registers[register_y_index];
 }
 
-void chip8_instruction_8XY1(struct chip8 *chip8)
-{
-    // Instruction: Set register X to the result of bitwise register X OR register Y
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
-    chip8->registers[register_x_index] |= chip8->registers[register_y_index];
-    chip8->registers[0xF] = 0;
-}
-
-void chip8_instruction_8XY2(struct chip8 *chip8)
-{
-    // Instruction: Set register X to the result of bitwise register X AND register Y
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
-    chip8->registers[register_x_index] &= chip8->registers[register_y_index];
-    chip8->registers[0xF] = 0;
+#define CHIP8_DEFINE_LOGIC_INSTRUCTION(name, opcode, operator, resets_register_f) \
+void name(struct chip8 *chip8, uint16_t instruction) \
+{ \
+    /* Instruction: Set register X to the result of bitwise register X OR, AND or XOR register Y */ \
+    CHIP8_PROFILE_HANDLER(chip8, opcode); \
+    uint8_t register_x_index = (instruction & 0x0F00) >> 8; \
+    uint8_t register_y_index = (instruction & 0x00F0) >> 4; \
+    chip8->registers[register_x_index] operator chip8->registers[register_y_index]; \
+    if (resets_register_f) { \
+        chip8->registers[0xF] = 0; \
+    } \
 }
 
-void chip8_instruction_8XY3(struct chip8 *chip8)
-{
-    // Instruction: Set register X to the result of bitwise register X XOR register Y
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
-    chip8->registers[register_x_index] ^= chip8->registers[register_y_index];
-    chip8->registers[0xF] = 0;
-}
+CHIP8_DEFINE_LOGIC_INSTRUCTION(chip8_instruction_8XY1, 8XY1, |=, true)
+CHIP8_DEFINE_LOGIC_INSTRUCTION(chip8_instruction_8XY1_chip48, 8XY1, |=, false)
+CHIP8_DEFINE_LOGIC_INSTRUCTION(chip8_instruction_8XY2, 8XY2, &=, true)
+CHIP8_DEFINE_LOGIC_INSTRUCTION(chip8_instruction_8XY2_chip48, 8XY2, &=, false)
+CHIP8_DEFINE_LOGIC_INSTRUCTION(chip8_instruction_8XY3, 8XY3, ^=, true)
+CHIP8_DEFINE_LOGIC_INSTRUCTION(chip8_instruction_8XY3_chip48, 8XY3, ^=, false)
 
-void chip8_instruction_8XY4(struct chip8 *chip8)
+void chip8_instruction_8XY4(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Add register Y to register X
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
+    CHIP8_PROFILE_HANDLER(chip8, 8XY4);
+    uint8_t register_x_index = (instruction & 0x0F00) >> 8;
+    uint8_t register_y_index = (instruction & 0x00F0) >> 4;
     uint8_t result = chip8->registers[register_x_index] + chip8->registers[register_y_index];
     uint8_t carry = result < chip8->registers[register_x_index];
     chip8->registers[register_x_index] = result;
     chip8->registers[0xF] = carry;
 }
 
-void chip8_instruction_8XY5(struct chip8 *chip8)
+void chip8_instruction_8XY5(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Subtract register Y from register X
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
+    CHIP8_PROFILE_HANDLER(chip8, 8XY5);
+    uint8_t register_x_index = (instruction & 0x0F00) >> 8;
+    uint8_t register_y_index = (instruction & 0x00F0) >> 4;
     uint8_t result = chip8->registers[register_x_index] - chip8->registers[register_y_index];
     uint8_t carry = result < chip8->registers[register_x_index];
     chip8->registers[register_x_index] = result;
     chip8->registers[0xF] = carry;
 }
 
-void chip8_instruction_8XY6(struct chip8 *chip8)
-{
-    // Instruction: Set register X to register Y, shift register X one bit right, and then set register F to the shifted bit
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
-    uint8_t result = chip8->registers[register_y_index] >> 1;
-    uint8_t shifted_bit = chip8->registers[register_y_index] & 1;
-    chip8->registers[register_x_index] = result;
-    chip8->registers[0xF] = shifted_bit;
+#define CHIP8_DEFINE_INSTRUCTION_8XY6(name, shifts_register_y) \
+void name(struct chip8 *chip8, uint16_t instruction) \
+{ \
+    /* Instruction: Set register X to register Y (or keep register X), shift register X one bit right, and then set register F to the shifted bit */ \
+    CHIP8_PROFILE_HANDLER(chip8, 8XY6); \
+    uint8_t register_x_index = (instruction & 0x0F00) >> 8; \
+    uint8_t source_register_index = (shifts_register_y) ? ((instruction & 0x00F0) >> 4) : ((instruction & 0x0F00) >> 8); \
+    uint8_t result = chip8->registers[source_register_index] >> 1; \
+    uint8_t shifted_bit = chip8->registers[source_register_index] & 1; \
+    chip8->registers[register_x_index] = result; \
+    chip8->registers[0xF] = shifted_bit; \
 }
 
-void chip8_instruction_8XY7(struct chip8 *chip8)
+CHIP8_DEFINE_INSTRUCTION_8XY6(chip8_instruction_8XY6, true)
+CHIP8_DEFINE_INSTRUCTION_8XY6(chip8_instruction_8XY6_chip48, false)
+
+void chip8_instruction_8XY7(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Subtract register X from register Y and store result in register X
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
+    CHIP8_PROFILE_HANDLER(chip8, 8XY7);
+    uint8_t register_x_index = (instruction & 0x0F00) >> 8;
+    uint8_t register_y_index = (instruction & 0x00F0) >> 4;
     uint8_t result = chip8->registers[register_y_index] - chip8->registers[register_x_index];
     uint8_t carry = result < chip8->registers[register_y_index];
     chip8->registers[register_x_index] = result;
     chip8->registers[0xF] = carry;
 }
 
-void chip8_instruction_8XYE(struct chip8 *chip8)
-{
-    // Instruction: Set register X to register Y, shift register X one bit left, and then set register F to the shifted bit
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
-    uint8_t result = chip8->registers[register_y_index] << 1;
-    uint8_t shifted_bit = (chip8->registers[register_y_index] & 128) >> 7;
-    chip8->registers[register_x_index] = result;
-    chip8->registers[0xF] = shifted_bit;
+#define CHIP8_DEFINE_INSTRUCTION_8XYE(name, shifts_register_y) \
+void name(struct chip8 *chip8, uint16_t instruction) \
+{ \
+    /* Instruction: Set register X to register Y (or keep register X), shift register X one bit left, and then set register F to the shifted bit */ \
+    CHIP8_PROFILE_HANDLER(chip8, 8XYE); \
+    uint8_t register_x_index = (instruction & 0x0F00) >> 8; \
+    uint8_t source_register_index = (shifts_register_y) ? ((instruction & 0x00F0) >> 4) : ((instruction & 0x0F00) >> 8); \
+    uint8_t result = chip8->registers[source_register_index] << 1; \
+    uint8_t shifted_bit = (chip8->registers[source_register_index] & 128) >> 7; \
+    chip8->registers[register_x_index] = result; \
+    chip8->registers[0xF] = shifted_bit; \
 }
 
-void chip8_instruction_9XY0(struct chip8 *chip8)
+CHIP8_DEFINE_INSTRUCTION_8XYE(chip8_instruction_8XYE, true)
+CHIP8_DEFINE_INSTRUCTION_8XYE(chip8_instruction_8XYE_chip48, false)
+
+void chip8_instruction_9XY0(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Skip next instruction if register X != register Y
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
+    CHIP8_PROFILE_HANDLER(chip8, 9XY0);
+    uint8_t register_x_index = (instruction & 0x0F00) >> 8;
+    uint8_t register_y_index = (instruction & 0x00F0) >> 4;
     if (chip8->registers[register_x_index] != chip8->registers[register_y_index]) {
         chip8->program_counter += 2;
     }
 }
 
-void chip8_instruction_ANNN(struct chip8 *chip8)
+void chip8_instruction_ANNN(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Set index register to NNN
-    uint16_t address_to_set = chip8->current_instruction & 0x0FFF;
+    CHIP8_PROFILE_HANDLER(chip8, ANNN);
+    uint16_t address_to_set = instruction & 0x0FFF;
     chip8->index_register = address_to_set;
 }
 
-void chip8_instruction_BNNN(struct chip8 *chip8)
-{
-    // Instruction: Jump to NNN + register 0
-    uint16_t jump_address = (chip8->current_instruction & 0x0FFF) + chip8->registers[0];
-    chip8->program_counter = jump_address;
+#define CHIP8_DEFINE_INSTRUCTION_BNNN(name, adds_register_x) \
+void name(struct chip8 *chip8, uint16_t instruction) \
+{ \
+    /* Instruction: Jump to NNN + register 0, or to NNN + register X when adding register X */ \
+    CHIP8_PROFILE_HANDLER(chip8, BNNN); \
+    uint8_t register_index = (adds_register_x) ? ((instruction & 0x0F00) >> 8) : 0; \
+    uint16_t jump_address = (instruction & 0x0FFF) + chip8->registers[register_index]; \
+    chip8->program_counter = jump_address; \
 }
 
-void chip8_instruction_CXNN(struct chip8 *chip8)
+CHIP8_DEFINE_INSTRUCTION_BNNN(chip8_instruction_BNNN, false)
+CHIP8_DEFINE_INSTRUCTION_BNNN(chip8_instruction_BNNN_chip48, true)
+
+void chip8_instruction_CXNN(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Generate a random value from 0 to 255, bitwise AND it with NN, and then store it in register X
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
-    uint8_t and_value = chip8->current_instruction & 0x00FF;
-    int random_value = rand() % 256;
+    CHIP8_PROFILE_HANDLER(chip8, CXNN);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
+    uint8_t and_value = instruction & 0x00FF;
+    uint8_t random_value = chip8_next_random(chip8) >> 24;
     random_value &= and_value;
     chip8->registers[register_index] = random_value;
 }
 
-void chip8_instruction_DXYN(struct chip8 *chip8)
-{
-    // Instruction: Draw sprite from memory
-    if (!chip8->vblank_state) {
-        chip8->program_counter -= 2;
-        return;
-    }
-
-    uint8_t clear_flag = 0;
-    uint8_t register_y_index = (chip8->current_instruction & 0x00F0) >> 4;
-    int y = chip8->registers[register_y_index] % chip8->screen_height;
-    int row_count = chip8->current_instruction & 0x000F;
-    for (int row = 0; row < row_count; row++) {
-        uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-        int x = chip8->registers[register_x_index] % chip8->screen_width;
-        int pixel_row = chip8->memory[chip8->index_register + row];
-        for (int column = 0; column < 8; column++) {
-            bool sprite_pixel = (pixel_row >> (7 - column)) & 1;
-            bool *screen_pixel = chip8_get_pixel(chip8, x, y);
-            if (sprite_pixel & *screen_pixel) {
-                *screen_pixel = 0;
-                clear_flag = 1;
-            }
-            else if (sprite_pixel == 1) {
-                *screen_pixel = 1;
-            }
-            x++;
-            if (x >= chip8->screen_width) {
-                break;
-            }
-        }
-        y++;
-        if (y >= chip8->screen_height) {
-            break;
-        }
-    }
-    chip8->registers[0xF] = clear_flag;
+#define CHIP8_DEFINE_INSTRUCTION_DXYN(name, waits_for_vblank) \
+void name(struct chip8 *chip8, uint16_t instruction) \
+{ \
+    /* Instruction: Draw sprite from memory */ \
+    CHIP8_PROFILE_HANDLER(chip8, DXYN); \
+    if ((waits_for_vblank) && !chip8->vblank_state) { \
+        CHIP8_PROFILE_VBLANK_STALL(chip8); \
+        chip8->program_counter -= 2; \
+        return; \
+    } \
+\
+    /* \
+    Each sprite row is shifted into place as a whole screen row and then XORed into the screen. Pixels that would be drawn past the \
+    right edge of the screen are shifted out of the row, and rows past the bottom edge are skipped, so sprites are clipped instead of wrapped. \
+    */ \
+    uint64_t cleared_pixels = 0; \
+    int x = chip8->registers[((instruction & 0x0F00) >> 8)] % 64; \
+    int y = chip8->registers[((instruction & 0x00F0) >> 4)] % 32; \
+    int row_count = instruction & 0x000F; \
+    if (row_count > 32 - y) { \
+        row_count = 32 - y; \
+    } \
+    for (int row = 0; row < row_count; row++) { \
+        uint64_t sprite_row = ((uint64_t)chip8->memory[(chip8->index_register + row) & 0x0FFF] << 56) >> x; \
+        cleared_pixels |= chip8->screen_buffer[y + row] & sprite_row; \
+        CHIP8_HASH_SCREEN_ROW_WRITE(chip8, y + row, chip8->screen_buffer[y + row] ^ sprite_row); \
+        chip8->screen_buffer[y + row] ^= sprite_row; \
+        if (sprite_row != 0) { \
+            chip8->dirty_rows |= (uint32_t)1 << (y + row); \
+        } \
+    } \
+    uint8_t clear_flag = cleared_pixels != 0; \
+    chip8->registers[0xF] = clear_flag; \
 }
 
-void chip8_instruction_EX9E(struct chip8 *chip8)
+CHIP8_DEFINE_INSTRUCTION_DXYN(chip8_instruction_DXYN, true)
+CHIP8_DEFINE_INSTRUCTION_DXYN(chip8_instruction_DXYN_chip48, false)
+
+void chip8_instruction_EX9E(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Skip next instruction if the key corresponding to the value in register X is pressed
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
-    if (chip8->keyboard_state[chip8->registers[register_index]]) {
+    CHIP8_PROFILE_HANDLER(chip8, EX9E);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
+    uint8_t key_value = chip8->registers[register_index] & 0x0F;
+    if ((chip8->keyboard_state >> key_value) & 1) {
         chip8->program_counter += 2;
     }
 }
 
-void chip8_instruction_EXA1(struct chip8 *chip8)
+void chip8_instruction_EXA1(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Skip next instruction if the key corresponding to the value in register X is pressed
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
-    if (!(chip8->keyboard_state[chip8->registers[register_index]])) {
+    CHIP8_PROFILE_HANDLER(chip8, EXA1);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
+    uint8_t key_value = chip8->registers[register_index] & 0x0F;
+    if (!((chip8->keyboard_state >> key_value) & 1)) {
         chip8->program_counter += 2;
     }
 }
 
-void chip8_instruction_FX07(struct chip8 *chip8)
+void chip8_instruction_FX07(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Set register X to the current value of the delay timer
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
+    CHIP8_PROFILE_HANDLER(chip8, FX07);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
     chip8->registers[register_index] = chip8->delay_timer;
 }
 
-void chip8_instruction_FX0A(struct chip8 *chip8)
+void chip8_instruction_FX0A(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Wait until the key corresponding to the value in register X is pressed and then released
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
-    int key_value = chip8->registers[register_index];
-    bool is_key_released = chip8->last_frame_keyboard_state[key_value] & !(chip8->keyboard_state[key_value]);
+    CHIP8_PROFILE_HANDLER(chip8, FX0A);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
+    uint8_t key_value = chip8->registers[register_index] & 0x0F;
+    bool is_key_released = ((chip8->last_frame_keyboard_state >> key_value) & 1) & !((chip8->keyboard_state >> key_value) & 1);
     if (!is_key_released) {
         chip8->program_counter -= 2;
     }
 }
 
-void chip8_instruction_FX15(struct chip8 *chip8)
+void chip8_instruction_FX15(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Set the delay timer to register X
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
+    CHIP8_PROFILE_HANDLER(chip8, FX15);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
     chip8->delay_timer = chip8->registers[register_index];
 }
 
-void chip8_instruction_FX18(struct chip8 *chip8)
+void chip8_instruction_FX18(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Set the sound timer to register X
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
+    CHIP8_PROFILE_HANDLER(chip8, FX18);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
+    bool was_sound_playing = chip8->sound_timer > 0;
     chip8->sound_timer = chip8->registers[register_index];
+    if (chip8->callbacks != NULL) {
+        chip8_call_sound_callbacks(chip8, was_sound_playing);
+    }
 }
 
-void chip8_instruction_FX1E(struct chip8 *chip8)
+void chip8_instruction_FX1E(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Add register X to index register
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
+    CHIP8_PROFILE_HANDLER(chip8, FX1E);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
     chip8->index_register += chip8->registers[register_index];
 }
 
-void chip8_instruction_FX29(struct chip8 *chip8)
+void chip8_instruction_FX29(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Point the index register to the first byte in memory of the character value in register X
-    uint8_t register_index = (chip8->current_instruction & 0x0F00) >> 8;
+    CHIP8_PROFILE_HANDLER(chip8, FX29);
+    uint8_t register_index = (instruction & 0x0F00) >> 8;
     int character_value = chip8->registers[register_index];
     chip8->index_register = chip8->memory[character_value * 5];
 }
 
-void chip8_instruction_FX33(struct chip8 *chip8)
+void chip8_instruction_FX33(struct chip8 *chip8, uint16_t instruction)
 {
     // Instruction: Store the three decimal digits of register X left to right starting at the location pointed to by the index register
+    CHIP8_PROFILE_HANDLER(chip8, FX33);
     int digits[3] = {0};
     
     int i = 2;
-    int register_value = chip8->registers[(chip8->current_instruction & 0x0F00) >> 8];
+    int register_value = chip8->registers[((instruction & 0x0F00) >> 8)];
     while (register_value != 0) {
         digits[i] = register_value % 10;
         i--;
         register_value /= 10;
     }
 
-    chip8->memory[chip8->index_register] = digits[0];
-    chip8->memory[chip8->index_register + 1] = digits[1];
-    chip8->memory[chip8->index_register + 2] = digits[2];
+    for (int digit = 0; digit < 3; digit++) {
+        CHIP8_HASH_MEMORY_WRITE(chip8, chip8->index_register + digit, digits[digit]);
+        chip8->memory[(chip8->index_register + digit) & 0x0FFF] = digits[digit];
+    }
+    chip8_invalidate_decoded_instruction(chip8, chip8->index_register);
+    chip8_invalidate_decoded_instruction(chip8, chip8->index_register + 2);
+}
+
+#define CHIP8_DEFINE_INSTRUCTION_FX55(name, index_increment) \
+void name(struct chip8 *chip8, uint16_t instruction) \
+{ \
+    /* Instruction: Store registers 0 through X in memory starting at the location pointed to by the index register, and then increment the index register */ \
+    CHIP8_PROFILE_HANDLER(chip8, FX55); \
+    uint8_t register_x_index = (instruction & 0x0F00) >> 8; \
+    for (int i = 0; i < register_x_index + 1; i++) { \
+        CHIP8_HASH_MEMORY_WRITE(chip8, chip8->index_register + i, chip8->registers[i]); \
+        chip8->memory[(chip8->index_register + i) & 0x0FFF] = chip8->registers[i]; \
+        chip8_invalidate_decoded_instruction(chip8, chip8->index_register + i); \
+    } \
+    chip8->index_register += (index_increment); \
+}
+
+#define CHIP8_DEFINE_INSTRUCTION_FX65(name, index_increment) \
+void name(struct chip8 *chip8, uint16_t instruction) \
+{ \
+    /* Instruction: Load memory starting at the location pointed to by the index register into registers 0 through X, and then increment the index register */ \
+    CHIP8_PROFILE_HANDLER(chip8, FX65); \
+    uint8_t register_x_index = (instruction & 0x0F00) >> 8; \
+    for (int i = 0; i < register_x_index + 1; i++) { \
+        chip8->registers[i] = chip8->memory[(chip8->index_register + i) & 0x0FFF]; \
+    } \
+    chip8->index_register += (index_increment); \
 }
 
-void chip8_instruction_FX55(struct chip8 *chip8)
+// The index register is incremented by X + 1 on the COSMAC VIP, by X on the CHIP-48, and not at all on the SUPER-CHIP
+CHIP8_DEFINE_INSTRUCTION_FX55(chip8_instruction_FX55, register_x_index + 1)
+CHIP8_DEFINE_INSTRUCTION_FX55(chip8_instruction_FX55_chip48, register_x_index)
+CHIP8_DEFINE_INSTRUCTION_FX55(chip8_instruction_FX55_superchip, 0)
+CHIP8_DEFINE_INSTRUCTION_FX65(chip8_instruction_FX65, register_x_index + 1)
+CHIP8_DEFINE_INSTRUCTION_FX65(chip8_instruction_FX65_chip48, register_x_index)
+CHIP8_DEFINE_INSTRUCTION_FX65(chip8_instruction_FX65_superchip, 0)
+
+/*
+The instruction jump tables are shared by every instance and every quirk profile, and map instructions to the indices of their handlers.
+A handler index is the handler's enum chip8_handler plus 1, so that 0 marks invalid instructions and decode cache entries that weren't decoded.
+Instructions that have the most significant half-byte 0, 8, E or F are looked up in a second table, as described in chip8_execute_current_instruction.
+*/
+static const uint8_t chip8_instruction_jump_table[0x10] = {
+    [0x1] = CHIP8_HANDLER_INDEX(1NNN),
+    [0x2] = CHIP8_HANDLER_INDEX(2NNN),
+    [0x3] = CHIP8_HANDLER_INDEX(3XNN),
+    [0x4] = CHIP8_HANDLER_INDEX(4XNN),
+    [0x5] = CHIP8_HANDLER_INDEX(5XY0),
+    [0x6] = CHIP8_HANDLER_INDEX(6XNN),
+    [0x7] = CHIP8_HANDLER_INDEX(7XNN),
+    [0x9] = CHIP8_HANDLER_INDEX(9XY0),
+    [0xA] = CHIP8_HANDLER_INDEX(ANNN),
+    [0xB] = CHIP8_HANDLER_INDEX(BNNN),
+    [0xC] = CHIP8_HANDLER_INDEX(CXNN),
+    [0xD] = CHIP8_HANDLER_INDEX(DXYN),
+};
+
+static const uint8_t chip8_zero_instruction_jump_table[0xEF] = {
+    [0xE0] = CHIP8_HANDLER_INDEX(00E0),
+    [0xEE] = CHIP8_HANDLER_INDEX(00EE),
+};
+
+static const uint8_t chip8_eight_instruction_jump_table[0xF] = {
+    [0x0] = CHIP8_HANDLER_INDEX(8XY0),
+    [0x1] = CHIP8_HANDLER_INDEX(8XY1),
+    [0x2] = CHIP8_HANDLER_INDEX(8XY2),
+    [0x3] = CHIP8_HANDLER_INDEX(8XY3),
+    [0x4] = CHIP8_HANDLER_INDEX(8XY4),
+    [0x5] = CHIP8_HANDLER_INDEX(8XY5),
+    [0x6] = CHIP8_HANDLER_INDEX(8XY6),
+    [0x7] = CHIP8_HANDLER_INDEX(8XY7),
+    [0xE] = CHIP8_HANDLER_INDEX(8XYE),
+};
+
+static const uint8_t chip8_e_instruction_jump_table[0xA2] = {
+    [0x9E] = CHIP8_HANDLER_INDEX(EX9E),
+    [0xA1] = CHIP8_HANDLER_INDEX(EXA1),
+};
+
+static const uint8_t chip8_f_instruction_jump_table[0x66] = {
+    [0x07] = CHIP8_HANDLER_INDEX(FX07),
+    [0x0A] = CHIP8_HANDLER_INDEX(FX0A),
+    [0x15] = CHIP8_HANDLER_INDEX(FX15),
+    [0x18] = CHIP8_HANDLER_INDEX(FX18),
+    [0x1E] = CHIP8_HANDLER_INDEX(FX1E),
+    [0x29] = CHIP8_HANDLER_INDEX(FX29),
+    [0x33] = CHIP8_HANDLER_INDEX(FX33),
+    [0x55] = CHIP8_HANDLER_INDEX(FX55),
+    [0x65] = CHIP8_HANDLER_INDEX(FX65),
+};
+
+// Each quirk profile has its own handler table, indexed by handler index, which only differs in the handlers that have variants
+#define CHIP8_DEFINE_HANDLER_TABLE(name, suffix, index_increment_suffix) \
+static const chip8_instruction_handler name[CHIP8_HANDLER_COUNT + 1] = { \
+    [CHIP8_HANDLER_INDEX(00E0)] = chip8_instruction_00E0##suffix, \
+    [CHIP8_HANDLER_INDEX(00EE)] = chip8_instruction_00EE, \
+    [CHIP8_HANDLER_INDEX(1NNN)] = chip8_instruction_1NNN, \
+    [CHIP8_HANDLER_INDEX(2NNN)] = chip8_instruction_2NNN, \
+    [CHIP8_HANDLER_INDEX(3XNN)] = chip8_instruction_3XNN, \
+    [CHIP8_HANDLER_INDEX(4XNN)] = chip8_instruction_4XNN, \
+    [CHIP8_HANDLER_INDEX(5XY0)] = chip8_instruction_5XY0, \
+    [CHIP8_HANDLER_INDEX(6XNN)] = chip8_instruction_6XNN, \
+    [CHIP8_HANDLER_INDEX(7XNN)] = chip8_instruction_7XNN, \
+    [CHIP8_HANDLER_INDEX(8XY0)] = chip8_instruction_8XY0, \
+    [CHIP8_HANDLER_INDEX(8XY1)] = chip8_instruction_8XY1##suffix, \
+    [CHIP8_HANDLER_INDEX(8XY2)] = chip8_instruction_8XY2##suffix, \
+    [CHIP8_HANDLER_INDEX(8XY3)] = chip8_instruction_8XY3##suffix, \
+    [CHIP8_HANDLER_INDEX(8XY4)] = chip8_instruction_8XY4, \
+    [CHIP8_HANDLER_INDEX(8XY5)] = chip8_instruction_8XY5, \
+    [CHIP8_HANDLER_INDEX(8XY6)] = chip8_instruction_8XY6##suffix, \
+    [CHIP8_HANDLER_INDEX(8XY7)] = chip8_instruction_8XY7, \
+    [CHIP8_HANDLER_INDEX(8XYE)] = chip8_instruction_8XYE##suffix, \
+    [CHIP8_HANDLER_INDEX(9XY0)] = chip8_instruction_9XY0, \
+    [CHIP8_HANDLER_INDEX(ANNN)] = chip8_instruction_ANNN, \
+    [CHIP8_HANDLER_INDEX(BNNN)] = chip8_instruction_BNNN##suffix, \
+    [CHIP8_HANDLER_INDEX(CXNN)] = chip8_instruction_CXNN, \
+    [CHIP8_HANDLER_INDEX(DXYN)] = chip8_instruction_DXYN##suffix, \
+    [CHIP8_HANDLER_INDEX(EX9E)] = chip8_instruction_EX9E, \
+    [CHIP8_HANDLER_INDEX(EXA1)] = chip8_instruction_EXA1, \
+    [CHIP8_HANDLER_INDEX(FX07)] = chip8_instruction_FX07, \
+    [CHIP8_HANDLER_INDEX(FX0A)] = chip8_instruction_FX0A, \
+    [CHIP8_HANDLER_INDEX(FX15)] = chip8_instruction_FX15, \
+    [CHIP8_HANDLER_INDEX(FX18)] = chip8_instruction_FX18, \
+    [CHIP8_HANDLER_INDEX(FX1E)] = chip8_instruction_FX1E, \
+    [CHIP8_HANDLER_INDEX(FX29)] = chip8_instruction_FX29, \
+    [CHIP8_HANDLER_INDEX(FX33)] = chip8_instruction_FX33, \
+    [CHIP8_HANDLER_INDEX(FX55)] = chip8_instruction_FX55##index_increment_suffix, \
+    [CHIP8_HANDLER_INDEX(FX65)] = chip8_instruction_FX65##index_increment_suffix, \
+};
+
+CHIP8_DEFINE_HANDLER_TABLE(chip8_handler_table, , )
+CHIP8_DEFINE_HANDLER_TABLE(chip8_chip48_handler_table, _chip48, _chip48)
+CHIP8_DEFINE_HANDLER_TABLE(chip8_superchip_handler_table, _chip48, _superchip)
+
+// Indexed by enum chip8_quirk_profile. The SUPER-CHIP only differs from the CHIP-48 in FX55 and FX65
+static const chip8_instruction_handler *const chip8_quirk_profile_handler_tables[] = {
+    [CHIP8_QUIRKS_VIP] = chip8_handler_table,
+    [CHIP8_QUIRKS_CHIP48] = chip8_chip48_handler_table,
+    [CHIP8_QUIRKS_SUPERCHIP] = chip8_superchip_handler_table,
+};
+
+static const chip8_instruction_handler *chip8_get_handler_table(struct chip8 *chip8)
 {
-    // Instruction: Store registers 0 through X in memory starting at the location pointed to by the index register 
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    for (int i = 0; i < register_x_index + 1; i++) {
-        chip8->memory[chip8->index_register] = chip8->registers[i];
-        chip8->index_register++;
-    }
+    return chip8_quirk_profile_handler_tables[chip8->quirk_profile];
 }
 
-void chip8_instruction_FX65(struct chip8 *chip8)
+static uint8_t chip8_lookup_handler_index(uint16_t instruction)
 {
-    // Instruction: Load memory starting at the location pointed to by the index register into registers 0 through X
-    uint8_t register_x_index = (chip8->current_instruction & 0x0F00) >> 8;
-    for (int i = 0; i < register_x_index + 1; i++) {
-        chip8->registers[i] = chip8->memory[chip8->index_register];
-        chip8->index_register++;
+    uint8_t instruction_index = 0;
+    const uint8_t *instruction_jump_table_pointer = chip8_instruction_jump_table;
+    int instruction_jump_table_length = sizeof(chip8_instruction_jump_table) / sizeof(*chip8_instruction_jump_table);
+    uint8_t most_significant_half_byte = instruction >> 12;
+    switch (most_significant_half_byte) {
+        case 0x0:
+            instruction_index = instruction & 0x00FF;
+            instruction_jump_table_pointer = chip8_zero_instruction_jump_table;
+            instruction_jump_table_length = sizeof(chip8_zero_instruction_jump_table) / sizeof(*chip8_zero_instruction_jump_table);
+            break;
+        case 0x8:
+            instruction_index = instruction & 0x000F;
+            instruction_jump_table_pointer = chip8_eight_instruction_jump_table;
+            instruction_jump_table_length = sizeof(chip8_eight_instruction_jump_table) / sizeof(*chip8_eight_instruction_jump_table);
+            break;
+        case 0xE:
+            instruction_index = instruction & 0x00FF;
+            instruction_jump_table_pointer = chip8_e_instruction_jump_table;
+            instruction_jump_table_length = sizeof(chip8_e_instruction_jump_table) / sizeof(*chip8_e_instruction_jump_table);
+            break;
+        case 0xF:
+            instruction_index = instruction & 0x00FF;
+            instruction_jump_table_pointer = chip8_f_instruction_jump_table;
+            instruction_jump_table_length = sizeof(chip8_f_instruction_jump_table) / sizeof(*chip8_f_instruction_jump_table);
+            break;
+        default:
+            instruction_index = most_significant_half_byte;
+            break;
     }
+    if (instruction_index >= instruction_jump_table_length) {
+        return 0;
+    }
+    return instruction_jump_table_pointer[instruction_index];
 }
 
 int chip8_initialize(struct chip8 *chip8, int instructions_per_frame)
 {
+    struct chip8_options options = {
+        .instructions_per_frame = instructions_per_frame,
+        .execution_engine = CHIP8_ENGINE_INTERPRETER,
+    };
+    return chip8_initialize_with_options(chip8, &options);
+}
+
+int chip8_initialize_with_options(struct chip8 *chip8, const struct chip8_options *options)
+{
+    // A CHIP-8 that is initialized again frees its decode pages. Those of a CHIP-8 that isn't initialized hold garbage, so they are emptied without being freed
+    if (chip8->decode_page_owner == chip8) {
+        chip8_invalidate_decode_cache(chip8);
+    }
+    for (int page = 0; page < CHIP8_DECODE_PAGE_COUNT; page++) {
+        chip8->decode_pages[page] = &chip8_empty_decode_page;
+    }
+    chip8->shared_decode_pages = 0;
+    chip8->decode_page_generation = 0;
+    chip8->decode_page_owner = chip8;
+    chip8->random_seed = 0;
+    chip8->rewind = NULL;
+    chip8->trace = NULL;
+    chip8->debugger = NULL;
+    chip8->movie = NULL;
+    chip8->callbacks = NULL;
+    chip8->instructions_per_second = 0;
+    chip8->is_schedule_started = false;
+#ifdef CHIP8_ENABLE_PROFILING
+    chip8_reset_profile(chip8);
+#endif
     chip8_reset(chip8);
 
-    if (!chip8_set_instructions_per_frame(chip8, instructions_per_frame)) {
+    if (!chip8_set_instructions_per_frame(chip8, options->instructions_per_frame)) {
+        return 0;
+    }
+    if (options->execution_engine != CHIP8_ENGINE_INTERPRETER && options->execution_engine != CHIP8_ENGINE_THREADED) {
+        return 0;
+    }
+    if (options->quirk_profile != CHIP8_QUIRKS_VIP && options->quirk_profile != CHIP8_QUIRKS_CHIP48 && options->quirk_profile != CHIP8_QUIRKS_SUPERCHIP) {
         return 0;
     }
 
     chip8->screen_width = 64;
     chip8->screen_height = 32;
 
-    chip8->instructions_per_frame = instructions_per_frame;
-    chip8->instruction_jump_table[0x0] = chip8_lookup_in_zero_table;
-    chip8->instruction_jump_table[0x1] = chip8_instruction_1NNN;
-    chip8->instruction_jump_table[0x2] = chip8_instruction_2NNN;
-    chip8->instruction_jump_table[0x3] = chip8_instruction_3XNN;
-    chip8->instruction_jump_table[0x4] = chip8_instruction_4XNN;
-    chip8->instruction_jump_table[0x5] = chip8_instruction_5XY0;
-    chip8->instruction_jump_table[0x6] = chip8_instruction_6XNN;
-    chip8->instruction_jump_table[0x7] = chip8_instruction_7XNN;
-    chip8->instruction_jump_table[0x8] = chip8_lookup_in_eight_table;
-    chip8->instruction_jump_table[0x9] = chip8_instruction_9XY0;
-    chip8->instruction_jump_table[0xA] = chip8_instruction_ANNN;
-    chip8->instruction_jump_table[0xB] = chip8_instruction_BNNN;
-    chip8->instruction_jump_table[0xC] = chip8_instruction_CXNN;
-    chip8->instruction_jump_table[0xD] = chip8_instruction_DXYN;
-    chip8->instruction_jump_table[0xE] = chip8_lookup_in_e_table;
-    chip8->instruction_jump_table[0xF] = chip8_lookup_in_f_table;
-    chip8->zero_instruction_jump_table[0xE0] = chip8_instruction_00E0;
-    chip8->zero_instruction_jump_table[0xEE] = chip8_instruction_00EE;
-    chip8->eight_instruction_jump_table[0x0] = chip8_instruction_8XY0;
-    chip8->eight_instruction_jump_table[0x1] = chip8_instruction_8XY1;
-    chip8->eight_instruction_jump_table[0x2] = chip8_instruction_8XY2;
-    chip8->eight_instruction_jump_table[0x3] = chip8_instruction_8XY3;
-    chip8->eight_instruction_jump_table[0x4] = chip8_instruction_8XY4;
-    chip8->eight_instruction_jump_table[0x5] = chip8_instruction_8XY5; 
-    chip8->eight_instruction_jump_table[0x6] = chip8_instruction_8XY6; 
-    chip8->eight_instruction_jump_table[0x7] = chip8_instruction_8XY7; 
-    chip8->eight_instruction_jump_table[0xE] = chip8_instruction_8XYE;
-    chip8->e_instruction_jump_table[0x9E] = chip8_instruction_EX9E; 
-    chip8->e_instruction_jump_table[0xA1] = chip8_instruction_EXA1;
-    chip8->f_instruction_jump_table[0x07] = chip8_instruction_FX07; 
-    chip8->f_instruction_jump_table[0x0A] = chip8_instruction_FX0A; 
-    chip8->f_instruction_jump_table[0x15] = chip8_instruction_FX15; 
-    chip8->f_instruction_jump_table[0x18] = chip8_instruction_FX18; 
-    chip8->f_instruction_jump_table[0x1E] = chip8_instruction_FX1E; 
-    chip8->f_instruction_jump_table[0x29] = chip8_instruction_FX29; 
-    chip8->f_instruction_jump_table[0x33] = chip8_instruction_FX33; 
-    chip8->f_instruction_jump_table[0x55] = chip8_instruction_FX55;
-    chip8->f_instruction_jump_table[0x65] = chip8_instruction_FX65;
+    chip8->instructions_per_frame = options->instructions_per_frame;
+    chip8->execution_engine = options->execution_engine;
+    chip8->quirk_profile = options->quirk_profile;
 
     return 1;
 }
+
+void chip8_deinitialize(struct chip8 *chip8)
+{
+    chip8_invalidate_decode_cache(chip8);
+    chip8->decode_page_owner = NULL;  // So that a CHIP-8 initialized in the same memory later doesn't mistake it for its own
+}
@@ -1,75 +1,419 @@
-#ifndef CHIP8
-#define CHIP8
-
-#include <stdint.h>
-#include <stdbool.h>
-
-struct chip8 {  // Read-only
-    uint8_t memory[4096];
-    uint8_t registers[16];
-    uint16_t index_register;
-    uint16_t program_counter;
-    uint16_t current_instruction;
-    uint16_t stack[16];
-    int stack_pointer; 
-    int delay_timer; 
-    int sound_timer; 
-    bool keyboard_state[16];
-    bool last_frame_keyboard_state[0xF];
-    bool screen_buffer[64 * 32]; 
-    int screen_width; 
-    int screen_height; 
-    bool vblank_state; 
-    int instructions_per_frame; 
-    
-    void (*instruction_jump_table[0xF])(struct chip8 *chip8);
-    void (*zero_instruction_jump_table[0xEF])(struct chip8 *chip8);
-    void (*eight_instruction_jump_table[0xF])(struct chip8 *chip8);
-    void (*e_instruction_jump_table[0xA2])(struct chip8 *chip8);
-    void (*f_instruction_jump_table[0x66])(struct chip8 *chip8);
-};
-
-// The amount of instructions per frame must be greater than 0. Otherwise, the function will return 0
-int chip8_initialize(struct chip8 *chip8, int instructions_per_frame);
-
-// Returns 1 upon success, and 0 upon failure. NOTE: This function doesn't reset the CHIP-8 before loading the program
-int chip8_load_program(struct chip8 *chip8, const char *file_path);
-
-// The key value must be a value from 0 to F. Otherwise, the function will return 0
-int chip8_set_key_state(struct chip8 *chip8, int key_value, bool new_state);
-
-// Returns 0 if an invalid instruction was encountered. NOTE: This function should be called 60 times per second for accurate timer emulation
-int chip8_tick_frame(struct chip8 *chip8); 
-
-// The coordinates must be in screen bounds. Otherwise, the function will return NULL
-bool *chip8_get_pixel(struct chip8 *chip8, int x, int y);
-
-int chip8_get_screen_width(struct chip8 *chip8);
-
-int chip8_get_screen_height(struct chip8 *chip8);
-
-// Returns true when the sound timer is greater than 0
-bool chip8_should_sound_play(struct chip8 *chip8);
-
-// The amount must be greater than 0. Otherwise, the function will return 0
-int chip8_set_instructions_per_frame(struct chip8 *chip8, int amount);
-
-void chip8_reset(struct chip8 *chip8);
-
-bool chip8_is_instruction_valid(struct chip8 *chip8, uint16_t instruction);
-
-/*
-The following three functions are called internally in chip8_tick_frame. 
-They should only be used when instruction-level stepping is required(instruction step debug feature, etc.) 
-*/
-
-// This function should be called 60 times per second for accurate timer emulation
-void chip8_update_timers(struct chip8 *chip8);
-
-// This function should be called chip8.instructions_per_frame times per frame
-void chip8_fetch_next_instruction(struct chip8 *chip8);
-
-// Returns 0 if the current instruction is invalid. NOTE: This function should always be called after calling chip8_fetch_next_instruction
-int chip8_execute_current_instruction(struct chip8 *chip8);
-
+#ifndef CHIP8
+#define CHIP8
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct chip8;
+struct chip8_decode_page;
+struct chip8_rewind;
+struct chip8_trace;
+struct chip8_debugger;
+struct chip8_image;
+struct chip8_movie;
+
+// Every instruction handler, in the order of enum chip8_handler
+#define CHIP8_HANDLERS(HANDLER) \
+    HANDLER(00E0) HANDLER(00EE) HANDLER(1NNN) HANDLER(2NNN) HANDLER(3XNN) HANDLER(4XNN) HANDLER(5XY0) HANDLER(6XNN) HANDLER(7XNN) \
+    HANDLER(8XY0) HANDLER(8XY1) HANDLER(8XY2) HANDLER(8XY3) HANDLER(8XY4) HANDLER(8XY5) HANDLER(8XY6) HANDLER(8XY7) HANDLER(8XYE) \
+    HANDLER(9XY0) HANDLER(ANNN) HANDLER(BNNN) HANDLER(CXNN) HANDLER(DXYN) HANDLER(EX9E) HANDLER(EXA1) HANDLER(FX07) HANDLER(FX0A) \
+    HANDLER(FX15) HANDLER(FX18) HANDLER(FX1E) HANDLER(FX29) HANDLER(FX33) HANDLER(FX55) HANDLER(FX65)
+
+enum chip8_handler {
+#define CHIP8_HANDLER_ENUMERATOR(opcode) CHIP8_HANDLER_##opcode,
+    CHIP8_HANDLERS(CHIP8_HANDLER_ENUMERATOR)
+#undef CHIP8_HANDLER_ENUMERATOR
+    CHIP8_HANDLER_COUNT
+};
+
+enum chip8_execution_engine {
+    CHIP8_ENGINE_INTERPRETER,  // Decodes and executes one instruction at a time
+    CHIP8_ENGINE_THREADED,  // Compiles basic blocks into threaded code and executes a whole block at a time
+};
+
+// Selects the behavior of the instructions that differ between CHIP-8 implementations
+enum chip8_quirk_profile {
+    CHIP8_QUIRKS_VIP,  // The original COSMAC VIP interpreter. 8XY1-8XY3 reset register F, 8XY6/8XYE shift register Y, FX55/FX65 increment I by X + 1, and 00E0/DXYN wait for vblank
+    CHIP8_QUIRKS_CHIP48,  // 8XY6/8XYE shift register X, BNNN jumps to NNN + register X, FX55/FX65 increment I by X, and nothing waits for vblank
+    CHIP8_QUIRKS_SUPERCHIP,  // Same as CHIP-48, except that FX55/FX65 leave I unchanged
+};
+
+enum chip8_pixel_format {
+    CHIP8_PIXEL_FORMAT_1BPP,  // 8 bytes per row. The most significant bit of a row's first byte is its leftmost pixel
+    CHIP8_PIXEL_FORMAT_8BPP,  // 64 bytes per row. Pixels are 0x00 when off and 0xFF when on
+    CHIP8_PIXEL_FORMAT_RGBA32,  // 256 bytes per row. Pixels are R, G, B and A bytes, and are opaque black when off and opaque white when on
+};
+
+enum chip8_address_flag {
+    CHIP8_ADDRESS_CODE = 0x01,  // A reachable instruction starts at the address
+    CHIP8_ADDRESS_BRANCH_TARGET = 0x02,  // The address is the target of a jump, a call or a skip
+    CHIP8_ADDRESS_INVALID = 0x04,  // A reachable invalid instruction is at the address
+    CHIP8_ADDRESS_INDIRECT_JUMP = 0x08,  // A reachable BNNN instruction, whose targets aren't followed, is at the address
+    CHIP8_ADDRESS_WRITTEN = 0x10,  // The address may be written to by FX55 or FX33
+    CHIP8_ADDRESS_SELF_MODIFYING = 0x20,  // The FX55 or FX33 instruction at the address may write to code, or to an unknown address
+};
+
+struct chip8_analysis {
+    uint8_t address_flags[4096];  // enum chip8_address_flag values for each address. Bytes that aren't part of a reachable instruction are data
+    int instruction_count;  // Reachable valid instructions
+    int invalid_instruction_count;
+    int indirect_jump_count;
+    int self_modification_hazard_count;
+};
+
+#define CHIP8_TRACE_FILE_VERSION 1  // The version written to the header of trace files
+#define CHIP8_TRACE_RECORD_SIZE 8  // The size of a record in a trace file
+
+// One executed instruction, with the registers it may have changed as they were after executing it
+struct chip8_trace_record {
+    uint16_t address;
+    uint16_t instruction;
+    uint16_t index_register;
+    uint8_t register_x;  // The register selected by the instruction's second half-byte
+    uint8_t register_f;
+};
+
+#define CHIP8_TICK_BREAK 2  // Returned by chip8_tick_frame when a breakpoint or watchpoint interrupted the frame
+
+enum chip8_break_reason {
+    CHIP8_BREAK_NONE,
+    CHIP8_BREAK_BREAKPOINT,  // Stopped before executing the instruction at a breakpoint
+    CHIP8_BREAK_MEMORY_WATCHPOINT,  // Stopped after an instruction wrote to a watched address
+    CHIP8_BREAK_INDEX_REGISTER_WATCHPOINT,  // Stopped after an instruction changed the index register
+    CHIP8_BREAK_REGISTER_WATCHPOINT,  // Stopped after an instruction changed a watched register
+};
+
+struct chip8_break {
+    enum chip8_break_reason reason;
+    uint16_t address;  // The address of the instruction that hit the breakpoint or watchpoint
+    uint16_t memory_address;  // The first watched address that was written to. Only set for memory watchpoints
+    uint8_t register_index;  // The watched register that changed. Only set for register watchpoints
+};
+
+// Any of the callbacks may be NULL. Callbacks are called in the middle of ticking the CHIP-8, so they must not modify it
+struct chip8_callbacks {
+    void (*on_display_changed)(struct chip8 *chip8, uint32_t dirty_rows, void *user_data);  // At the end of every frame that changed the screen
+    void (*on_sound_start)(struct chip8 *chip8, void *user_data);  // When FX18 sets the sound timer from 0 to a greater value
+    void (*on_sound_stop)(struct chip8 *chip8, void *user_data);  // When the sound timer reaches 0, either counting down or set by FX18
+    void (*on_key_wait)(struct chip8 *chip8, int register_index, void *user_data);  // At the end of the first frame spent waiting in FX0A
+    void (*on_invalid_instruction)(struct chip8 *chip8, uint16_t address, uint16_t instruction, void *user_data);  // Before chip8_tick_frame returns 0
+    void *user_data;  // Passed to every callback
+};
+
+#define CHIP8_SCHEDULE_MAXIMUM_BURST_FRAMES 4  // The most frames chip8_run_until ticks in one call while catching up
+#define CHIP8_SCHEDULE_MAXIMUM_LAG_FRAMES 30  // When more frames than this are due, chip8_run_until skips all but a burst of them
+
+struct chip8_run_report {
+    int frame_count;  // Frames ticked. When greater than 1, the frames were coalesced, and chip8_get_dirty_rows reports the rows changed by any of them
+    int skipped_frame_count;  // Frames skipped because the host fell too far behind
+};
+
+struct chip8_options {
+    int instructions_per_frame;
+    enum chip8_execution_engine execution_engine;
+    enum chip8_quirk_profile quirk_profile;  // CHIP8_QUIRKS_VIP when zero-initialized
+};
+
+#ifdef CHIP8_ENABLE_PROFILING
+struct chip8_profile {
+    uint64_t handler_counts[CHIP8_HANDLER_COUNT];  // Executions of each instruction handler, indexed by enum chip8_handler
+    uint64_t address_counts[4096];  // Instructions executed at each address in memory
+    uint64_t vblank_stall_count;  // Times a DXYN or 00E0 instruction was retried because it waited for the vertical blank
+    uint64_t frame_count;  // Frames ticked by chip8_tick_frame, excluding frames that encountered an invalid instruction
+    uint64_t total_frame_nanoseconds;
+    uint64_t max_frame_nanoseconds;
+};
+#endif
+
+struct chip8 {  // Read-only
+    // Hot state, kept together in front of memory
+    uint8_t registers[16];
+    uint16_t index_register;
+    uint16_t program_counter;
+    uint16_t current_instruction;
+    uint16_t stack[16];
+    uint8_t stack_pointer; 
+    uint8_t delay_timer; 
+    uint8_t sound_timer; 
+    bool vblank_state; 
+    uint16_t keyboard_state;  // Bit N is set when key N is pressed
+    uint16_t last_frame_keyboard_state;
+    uint32_t dirty_rows;  // Bit N is set when row N of the screen changed during the last frame
+    uint32_t random_state;
+    uint32_t random_seed;
+    int instructions_per_frame; 
+    int instructions_per_second;  // Used by chip8_run_until instead of instructions_per_frame when greater than 0
+    enum chip8_execution_engine execution_engine;
+    enum chip8_quirk_profile quirk_profile;
+    uint8_t screen_width; 
+    uint8_t screen_height; 
+    bool is_idle;  // Set when the last frame ended early because the program was waiting
+    int skipped_instruction_count;  // The amount of instructions the last frame skipped by ending early
+    bool is_frame_interrupted;  // Set when a breakpoint or watchpoint interrupted the current frame, which the next call to chip8_tick_frame finishes
+    int interrupted_frame_instruction_count;  // The amount of instructions left in the interrupted frame
+    uint16_t program_size;  // The size of the last loaded program in bytes
+#ifdef CHIP8_ENABLE_STATE_HASH
+    uint64_t state_hash;  // Hash of memory and the screen, which is updated on every write to them. See chip8_get_state_hash
+#endif
+
+    uint8_t memory[4096];
+    uint64_t screen_buffer[32];  // One element per row. The most significant bit of a row is its leftmost pixel
+
+    // Everything above is plain state which chip8_clone copies as is. Fields that hold pointers must be placed below. NOTE: Copying a whole CHIP-8 by
+    // value doesn't copy its decode pages, so the copy drops the ones it points to and decodes its program again. Use chip8_clone to copy a CHIP-8
+    // The decode cache, one page per 64 bytes of memory. Pages point to a shared empty page until something on them is decoded, or to the image's
+    // page until they are written to, and are only allocated once the CHIP-8 needs its own copy
+    const struct chip8_decode_page *decode_pages[4096 / 64];
+    struct chip8_image *image;  // The image the program was loaded from, or NULL
+    const struct chip8 *decode_page_owner;  // The CHIP-8 that allocated the decode pages. Differs from the CHIP-8 itself after it was copied by value
+    uint64_t shared_decode_pages;  // Bit N is set when decode page N points to the image's page
+    uint32_t decode_page_generation;  // Incremented whenever a decode page is allocated or freed, so that page pointers can be kept between blocks
+    struct chip8_rewind *rewind;  // NULL when no rewind history is attached
+    struct chip8_trace *trace;  // NULL when no trace is attached
+    struct chip8_debugger *debugger;  // NULL when no debugger is attached
+    struct chip8_movie *movie;  // NULL when no movie is being recorded
+    const struct chip8_callbacks *callbacks;  // NULL when no callbacks are set
+    bool was_waiting_for_key;  // Set when the last frame ended waiting in FX0A while callbacks were set
+    // Timeline of chip8_run_until, which starts at the first call
+    bool is_schedule_started;
+    uint64_t schedule_start_time;
+    uint64_t scheduled_frame_count;  // The frames of the timeline that were ticked or skipped
+    int instruction_budget_remainder;  // Sixtieths of an instruction carried over to the next frame
+#ifdef CHIP8_ENABLE_PROFILING
+    struct chip8_profile profile;
+#endif
+};
+
+// The amount of instructions per frame must be greater than 0. Otherwise, the function will return 0
+int chip8_initialize(struct chip8 *chip8, int instructions_per_frame);
+
+// Same as chip8_initialize, but also selects the execution engine and quirk profile. Returns 0 if any of the options are invalid
+int chip8_initialize_with_options(struct chip8 *chip8, const struct chip8_options *options);
+
+// Frees the decode cache pages that the CHIP-8 allocated. NOTE: Must be called before an initialized CHIP-8 is discarded. Initializing a CHIP-8 again frees its pages as well. A zero-initialized CHIP-8 may also be deinitialized
+void chip8_deinitialize(struct chip8 *chip8);
+
+#define CHIP8_MAXIMUM_PROGRAM_SIZE (4096 - 0x200)  // Programs are loaded at address 0x200
+
+// Returns 1 upon success, and 0 upon failure, including when the program is larger than CHIP8_MAXIMUM_PROGRAM_SIZE. NOTE: This function doesn't reset the CHIP-8 before loading the program
+int chip8_load_program(struct chip8 *chip8, const char *file_path);
+
+// Same as chip8_load_program, but loads the program from a buffer, which can be freed afterwards
+int chip8_load_program_from_buffer(struct chip8 *chip8, const void *program, size_t program_size);
+
+// Returns NULL if the program is larger than CHIP8_MAXIMUM_PROGRAM_SIZE, if the quirk profile is invalid, or if the image couldn't be allocated. The program is decoded ahead of time, and can be freed afterwards
+struct chip8_image *chip8_image_create(const void *program, size_t program_size, enum chip8_quirk_profile quirk_profile);
+
+// NOTE: The image must outlive every CHIP-8 loaded from it, or cloned from one, until they are reset
+void chip8_image_destroy(struct chip8_image *image);
+
+// Resets the CHIP-8 and loads the image's program. Returns 0 if the image's quirk profile differs from the CHIP-8's. NOTE: CHIP-8s loaded from the same image share its decoded instructions, and only allocate their own copy of a 64-byte page of them the first time they write to it
+int chip8_load_image(struct chip8 *chip8, struct chip8_image *image);
+
+// Returns the size in bytes of the last loaded program, or 0 if no program was loaded since the CHIP-8 was reset
+uint16_t chip8_get_program_size(struct chip8 *chip8);
+
+// The key value must be a value from 0 to F. Otherwise, the function will return 0
+int chip8_set_key_state(struct chip8 *chip8, int key_value, bool new_state);
+
+// Sets the state of every key at once. Bit N of the mask is the state of key N
+void chip8_set_keyboard_state(struct chip8 *chip8, uint16_t key_mask);
+
+// Returns 0 if an invalid instruction was encountered, and CHIP8_TICK_BREAK if a breakpoint or watchpoint interrupted the frame, which the next call finishes. NOTE: This function should be called 60 times per second for accurate timer emulation
+int chip8_tick_frame(struct chip8 *chip8); 
+
+// Calls the callbacks on display, sound and key wait changes, so that hosts don't have to poll for them. Passing NULL removes the callbacks. NOTE: The table isn't copied, and can be shared by many CHIP-8s. chip8_initialize removes any set callbacks
+void chip8_set_callbacks(struct chip8 *chip8, const struct chip8_callbacks *callbacks);
+
+// Sets the rate at which chip8_run_until executes instructions, which is spread evenly across frames, so that it doesn't need to be a multiple of 60. Passing 0 runs chip8.instructions_per_frame instructions per frame instead. Returns 0 if the amount is negative
+int chip8_set_instructions_per_second(struct chip8 *chip8, int amount);
+
+// Ticks every frame due by the target time in nanoseconds, with frames and timers at exactly 60 per second on a timeline that starts at the first call. Returns the same values as chip8_tick_frame, and fills in the report unless it is NULL. NOTE: Target times only need to be monotonic, such as from a host's monotonic clock
+int chip8_run_until(struct chip8 *chip8, uint64_t target_time, struct chip8_run_report *report);
+
+// Starts a new timeline at the next call to chip8_run_until, such as after the host paused emulation
+void chip8_reset_schedule(struct chip8 *chip8);
+
+// The coordinates must be in screen bounds. Otherwise, the function will return false
+bool chip8_get_pixel(struct chip8 *chip8, int x, int y);
+
+// Returns the screen's rows packed one pixel per bit. The most significant bit of a row is its leftmost pixel
+const uint64_t *chip8_get_screen_rows(struct chip8 *chip8);
+
+// Returns a mask where bit N is set when row N of the screen was changed during the last call to chip8_tick_frame
+uint32_t chip8_get_dirty_rows(struct chip8 *chip8);
+
+// Returns true when the screen was changed during the last call to chip8_tick_frame
+bool chip8_has_screen_changed(struct chip8 *chip8);
+
+// Writes the rows selected by row_mask into the buffer, which is laid out as the whole screen in the given format. Returns the amount of rows written, or 0 if the format is invalid
+int chip8_export_screen(struct chip8 *chip8, void *buffer, enum chip8_pixel_format pixel_format, uint32_t row_mask);
+
+int chip8_get_screen_width(struct chip8 *chip8);
+
+int chip8_get_screen_height(struct chip8 *chip8);
+
+// Returns true when the last call to chip8_tick_frame ended the frame early because the program was waiting for vblank, a key or the delay timer, or was stuck in a loop. NOTE: Hosts can sleep until the next frame in that case
+bool chip8_is_idle(struct chip8 *chip8);
+
+// Returns the amount of instructions that the last call to chip8_tick_frame skipped by ending the frame early, which weren't executed
+int chip8_get_skipped_instruction_count(struct chip8 *chip8);
+
+// Returns true when the sound timer is greater than 0
+bool chip8_should_sound_play(struct chip8 *chip8);
+
+// The amount must be greater than 0. Otherwise, the function will return 0
+int chip8_set_instructions_per_frame(struct chip8 *chip8, int amount);
+
+// NOTE: Resetting the CHIP-8 also restarts its random number sequence from the last seed it was given
+void chip8_reset(struct chip8 *chip8);
+
+// Seeds the random number generator used by CXNN instructions. Each instance has its own generator, which is seeded with 0 by chip8_initialize
+void chip8_seed_random(struct chip8 *chip8, uint32_t seed);
+
+bool chip8_is_instruction_valid(struct chip8 *chip8, uint16_t instruction);
+
+// Walks the code reachable from the program counter and fills in the analysis. Returns 1 if the program has no reachable invalid instructions, indirect jumps or instructions that may modify code, and 0 otherwise. NOTE: Reachable instructions are also decoded ahead of time
+int chip8_analyze_program(struct chip8 *chip8, struct chip8_analysis *analysis);
+
+// Returns the size in bytes of a save state
+size_t chip8_get_save_state_size(void);
+
+// Saves the CHIP-8's state into the buffer in a stable, versioned layout. Returns 0 if the buffer is smaller than chip8_get_save_state_size()
+int chip8_save_state(struct chip8 *chip8, void *buffer, size_t buffer_size);
+
+// Restores a state saved by chip8_save_state. Returns 0 if the buffer doesn't hold a save state of a supported version. NOTE: The CHIP-8's instructions per frame and execution engine aren't part of its state, and are kept
+int chip8_load_state(struct chip8 *chip8, const void *buffer, size_t buffer_size);
+
+// Copies the source CHIP-8's state and settings into the destination CHIP-8, which must be initialized. Only valid within the same process. NOTE: Use this instead of copying a CHIP-8 by value, which leaves the copy without a decode cache
+void chip8_clone(struct chip8 *destination, const struct chip8 *source);
+
+// Returns NULL if the buffer size is smaller than twice chip8_get_save_state_size(), or if either amount isn't greater than 0. The history keeps a full keyframe every keyframe_interval frames, and only the changes from the previous frame in between
+struct chip8_rewind *chip8_rewind_create(size_t buffer_size, int max_frames, int keyframe_interval);
+
+void chip8_rewind_destroy(struct chip8_rewind *rewind);
+
+// Records the CHIP-8's state at the end of every call to chip8_tick_frame into the history. Passing NULL detaches the history. NOTE: chip8_initialize detaches any attached history
+void chip8_attach_rewind(struct chip8 *chip8, struct chip8_rewind *rewind);
+
+// Records the CHIP-8's current state. Once the buffer or the amount of frames is full, the oldest keyframe is dropped along with the frames that depend on it
+void chip8_rewind_record(struct chip8_rewind *rewind, struct chip8 *chip8);
+
+// Returns the amount of frames the history can step back by
+int chip8_rewind_get_frame_count(struct chip8_rewind *rewind);
+
+// Restores the state recorded the given amount of frames before the latest one, and drops the newer frames. Returns 0 if the amount isn't from 1 to chip8_rewind_get_frame_count()
+int chip8_rewind_step_back(struct chip8_rewind *rewind, struct chip8 *chip8, int frames);
+
+void chip8_rewind_clear(struct chip8_rewind *rewind);
+
+// Returns NULL if the amount of records isn't a power of 2, or if the trace couldn't be allocated. Once the trace is full, the oldest records are overwritten
+struct chip8_trace *chip8_trace_create(int record_count);
+
+void chip8_trace_destroy(struct chip8_trace *trace);
+
+// Appends a record for every instruction executed by chip8_tick_frame to the trace. Passing NULL detaches the trace. NOTE: Traced frames always run on the interpreter, and chip8_initialize detaches any attached trace
+void chip8_attach_trace(struct chip8 *chip8, struct chip8_trace *trace);
+
+// Returns the amount of records appended since the trace was created or cleared, including overwritten records
+uint64_t chip8_trace_get_record_count(struct chip8_trace *trace);
+
+// Returns NULL if the record at the given index was overwritten or hasn't been appended yet
+const struct chip8_trace_record *chip8_trace_get_record(struct chip8_trace *trace, uint64_t index);
+
+void chip8_trace_clear(struct chip8_trace *trace);
+
+// Writes the records that weren't overwritten to a file, which can be decoded and compared using tools/chip8_trace. Returns 0 if the file couldn't be written
+int chip8_trace_save(struct chip8_trace *trace, const char *file_path);
+
+// Returns NULL if the debugger couldn't be allocated
+struct chip8_debugger *chip8_debugger_create(void);
+
+void chip8_debugger_destroy(struct chip8_debugger *debugger);
+
+// Checks the debugger's breakpoints and watchpoints during chip8_tick_frame. Passing NULL detaches the debugger. NOTE: While any breakpoint or watchpoint is set, frames run on the interpreter, and chip8_initialize detaches any attached debugger
+void chip8_attach_debugger(struct chip8 *chip8, struct chip8_debugger *debugger);
+
+// The address must be a value from 0x000 to 0xFFF. Otherwise, the function will return 0
+int chip8_debugger_set_breakpoint(struct chip8_debugger *debugger, uint16_t address, bool is_enabled);
+
+// Watches for writes to the given range of memory. Returns 0 if the range doesn't fit in memory
+int chip8_debugger_watch_memory(struct chip8_debugger *debugger, uint16_t address, uint16_t length, bool is_enabled);
+
+// Watches for changes of the register. The register index must be a value from 0 to F. Otherwise, the function will return 0
+int chip8_debugger_watch_register(struct chip8_debugger *debugger, int register_index, bool is_enabled);
+
+void chip8_debugger_watch_index_register(struct chip8_debugger *debugger, bool is_enabled);
+
+// Removes every breakpoint and watchpoint
+void chip8_debugger_clear(struct chip8_debugger *debugger);
+
+// Returns the breakpoint or watchpoint that last interrupted a frame
+const struct chip8_break *chip8_debugger_get_break(struct chip8_debugger *debugger);
+
+// Returns NULL if the amount isn't greater than 0, or if the movie couldn't be allocated
+struct chip8_movie *chip8_movie_create(int max_frames);
+
+// Returns NULL if the file couldn't be read, or doesn't hold a movie of a supported version
+struct chip8_movie *chip8_movie_load(const char *file_path);
+
+void chip8_movie_destroy(struct chip8_movie *movie);
+
+// Records the keyboard state of every frame started by chip8_tick_frame into the movie, along with the CHIP-8's random seed. Passing NULL detaches the movie. NOTE: Recording should start right after the CHIP-8 is reset, and chip8_initialize detaches any attached movie
+void chip8_attach_movie(struct chip8 *chip8, struct chip8_movie *movie);
+
+// Returns 0 if the file couldn't be written
+int chip8_movie_save(struct chip8_movie *movie, const char *file_path);
+
+// Returns the amount of recorded frames. NOTE: Once the movie holds max_frames frames, later frames aren't recorded
+int chip8_movie_get_frame_count(struct chip8_movie *movie);
+
+// Returns the random seed of the CHIP-8 the movie was recorded from
+uint32_t chip8_movie_get_seed(struct chip8_movie *movie);
+
+// Returns the frame which the next call to chip8_run_frames replays
+int chip8_movie_get_position(struct chip8_movie *movie);
+
+// The frame must be a value from 0 to chip8_movie_get_frame_count(). Otherwise, the function will return 0
+int chip8_movie_seek(struct chip8_movie *movie, int frame);
+
+// Removes every recorded frame and seeks back to the start
+void chip8_movie_clear(struct chip8_movie *movie);
+
+// Ticks the given amount of frames, taking the keyboard state of each frame from the movie unless it is NULL, and stops early at the end of the movie. Returns the same values as chip8_tick_frame. NOTE: To replay a movie from the start, reset the CHIP-8, seed it with chip8_movie_get_seed and load the program first
+int chip8_run_frames(struct chip8 *chip8, struct chip8_movie *movie, int frame_count);
+
+// Writes the instruction's mnemonic, such as "ADD V1, 0x20", into the buffer. Returns 0 if the instruction is invalid, in which case it is written as "DW 0x0123"
+int chip8_disassemble(uint16_t instruction, char *buffer, size_t buffer_size);
+
+#ifdef CHIP8_ENABLE_PROFILING
+// Returns the counters collected since the CHIP-8 was initialized or its profile was last reset. NOTE: Only available when CHIP8_ENABLE_PROFILING is defined
+const struct chip8_profile *chip8_get_profile(struct chip8 *chip8);
+
+void chip8_reset_profile(struct chip8 *chip8);
+
+// Returns the handler's opcode, such as "8XY4", or NULL if the handler is invalid
+const char *chip8_get_handler_name(enum chip8_handler handler);
+#endif
+
+#ifdef CHIP8_ENABLE_STATE_HASH
+// Returns a 64-bit hash of memory, the screen, the registers, the stack, the timers, the keyboard and the random state. NOTE: Only available when CHIP8_ENABLE_STATE_HASH is defined
+uint64_t chip8_get_state_hash(struct chip8 *chip8);
+#endif
+
+/*
+The following three functions are called internally in chip8_tick_frame. 
+They should only be used when instruction-level stepping is required(instruction step debug feature, etc.) 
+*/
+
+// This function should be called 60 times per second for accurate timer emulation
+void chip8_update_timers(struct chip8 *chip8);
+
+// This function should be called chip8.instructions_per_frame times per frame
+void chip8_fetch_next_instruction(struct chip8 *chip8);
+
+// Returns 0 if the current instruction is invalid. NOTE: This function should always be called after calling chip8_fetch_next_instruction
+int chip8_execute_current_instruction(struct chip8 *chip8);
+
 #endif
\ No newline at end of file
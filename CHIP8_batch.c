@@ -0,0 +1,490 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <threads.h>
+#include <stdatomic.h>
+#include <CHIP8.h>
+#include <CHIP8_batch.h>
+
+struct chip8_batch_work_range {
+    _Alignas(64) atomic_int next_index;  // Each range is kept on its own cache line, since every worker may take instances from it
+    int end_index;
+};
+
+struct chip8_batch_worker {
+    struct chip8_batch *batch;
+    int worker_index;
+};
+
+struct chip8_batch {
+    struct chip8 *instances;
+    int *results;
+    int instance_count;
+
+    int thread_count;
+    int started_thread_count;
+    thrd_t *threads;
+    struct chip8_batch_worker *workers;
+    struct chip8_batch_work_range *work_ranges;  // One per worker, including the thread that calls chip8_batch_tick_frames
+    mtx_t mutex;
+    cnd_t work_available;
+    cnd_t work_finished;
+    bool is_synchronization_initialized;
+    unsigned long work_generation;  // Incremented for every call to chip8_batch_tick_frames, to wake the workers
+    int busy_worker_count;
+    bool is_shutting_down;
+
+    int frames_to_tick;
+    atomic_int failed_instance_count;
+    atomic_int paused_instance_count;  // Instances that a breakpoint or watchpoint paused during the last call
+
+    // Vectorized environment state, see chip8_vec_step
+    bool is_vec_configured;
+    bool is_vec_reset;
+    bool is_vec_step;  // Whether the current work is a call to chip8_vec_step rather than chip8_batch_tick_frames
+    struct chip8_vec_options vec_options;
+    size_t observation_frame_size;
+    size_t observation_size;
+    uint8_t *observation_history;  // One observation per instance, whose newest frame is the last one
+    uint8_t *reset_states;  // One save state per instance
+    struct chip8_vec_probe probes[CHIP8_VEC_MAXIMUM_PROBES];
+    int probe_count;
+    uint8_t *probe_values;  // CHIP8_VEC_MAXIMUM_PROBES values per instance, as of the last step
+    const uint16_t *actions;
+    uint8_t *observations;
+    float *rewards;
+    uint8_t *dones;
+};
+
+static uint8_t chip8_vec_read_probe(struct chip8 *chip8, const struct chip8_vec_probe *probe)
+{
+    if (probe->location == CHIP8_VEC_PROBE_REGISTER) {
+        return chip8->registers[probe->index];
+    }
+    return chip8->memory[probe->index];
+}
+
+static void chip8_vec_read_probe_values(struct chip8_batch *batch, int index)
+{
+    for (int i = 0; i < batch->probe_count; i++) {
+        batch->probe_values[index * CHIP8_VEC_MAXIMUM_PROBES + i] = chip8_vec_read_probe(&batch->instances[index], &batch->probes[i]);
+    }
+}
+
+static void chip8_vec_write_observation_frame(struct chip8_batch *batch, int index, uint8_t *frame)
+{
+    const uint64_t *screen_rows = chip8_get_screen_rows(&batch->instances[index]);
+    int factor = batch->vec_options.downsample_factor;
+    if (factor == 1) {
+        for (int y = 0; y < 32; y++) {
+            for (int x = 0; x < 64; x++) {
+                *frame++ = (screen_rows[y] >> (63 - x)) & 1 ? 0xFF : 0x00;
+            }
+        }
+        return;
+    }
+
+    uint64_t block_mask = (1 << factor) - 1;
+    for (int y = 0; y < 32 / factor; y++) {
+        for (int x = 0; x < 64 / factor; x++) {
+            int lit_pixel_count = 0;
+            for (int row = y * factor; row < (y + 1) * factor; row++) {
+                uint64_t block = (screen_rows[row] >> (64 - (x + 1) * factor)) & block_mask;
+                for (; block != 0; block &= block - 1) {
+                    lit_pixel_count++;
+                }
+            }
+            *frame++ = lit_pixel_count * 0xFF / (factor * factor);
+        }
+    }
+}
+
+static void chip8_vec_push_observation(struct chip8_batch *batch, int index, bool is_new_episode)
+{
+    // The history is shifted by a frame, since the stack is small. A new episode starts with every frame of the stack set to its first frame
+    uint8_t *history = &batch->observation_history[index * batch->observation_size];
+    uint8_t *newest_frame = history + batch->observation_size - batch->observation_frame_size;
+    if (!is_new_episode) {
+        memmove(history, history + batch->observation_frame_size, batch->observation_size - batch->observation_frame_size);
+    }
+    chip8_vec_write_observation_frame(batch, index, newest_frame);
+    if (is_new_episode) {
+        for (uint8_t *frame = history; frame < newest_frame; frame += batch->observation_frame_size) {
+            memcpy(frame, newest_frame, batch->observation_frame_size);
+        }
+    }
+    memcpy(&batch->observations[index * batch->observation_size], history, batch->observation_size);
+}
+
+static void chip8_vec_step_instance(struct chip8_batch *batch, int index)
+{
+    struct chip8 *chip8 = &batch->instances[index];
+    chip8_set_keyboard_state(chip8, batch->actions[index]);
+    bool is_done = false;
+    batch->results[index] = 1;
+    for (int frame = 0; frame < batch->vec_options.frames_per_step; frame++) {
+        int result = chip8_tick_frame(chip8);
+        if (result == 0) {
+            batch->results[index] = 0;
+            atomic_fetch_add(&batch->failed_instance_count, 1);
+            is_done = true;
+            break;
+        }
+        if (result == CHIP8_TICK_BREAK) {
+            // The instance is paused in the middle of the frame, and the episode goes on from there once the host steps it again
+            batch->results[index] = CHIP8_TICK_BREAK;
+            atomic_fetch_add(&batch->paused_instance_count, 1);
+            break;
+        }
+    }
+
+    float reward = 0.0f;
+    uint8_t *probe_values = &batch->probe_values[index * CHIP8_VEC_MAXIMUM_PROBES];
+    for (int i = 0; i < batch->probe_count; i++) {
+        const struct chip8_vec_probe *probe = &batch->probes[i];
+        uint8_t value = chip8_vec_read_probe(chip8, probe);
+        switch (probe->kind) {
+            case CHIP8_VEC_PROBE_REWARD:
+                reward += ((int)value - probe_values[i]) * probe->scale;
+                probe_values[i] = value;
+                break;
+            case CHIP8_VEC_PROBE_DONE_IF_EQUAL:
+                is_done |= value == probe->target;
+                break;
+            case CHIP8_VEC_PROBE_DONE_IF_NOT_EQUAL:
+                is_done |= value != probe->target;
+                break;
+        }
+    }
+
+    if (is_done) {
+        chip8_load_state(chip8, &batch->reset_states[index * chip8_get_save_state_size()], chip8_get_save_state_size());
+        chip8_vec_read_probe_values(batch, index);
+    }
+    chip8_vec_push_observation(batch, index, is_done);
+    batch->rewards[index] = reward;
+    batch->dones[index] = is_done;
+}
+
+static void chip8_batch_tick_instance(struct chip8_batch *batch, int index)
+{
+    batch->results[index] = 1;
+    for (int frame = 0; frame < batch->frames_to_tick; frame++) {
+        int result = chip8_tick_frame(&batch->instances[index]);
+        if (result == 0) {
+            batch->results[index] = 0;
+            atomic_fetch_add(&batch->failed_instance_count, 1);
+            return;
+        }
+        if (result == CHIP8_TICK_BREAK) {
+            // The instance is paused in the middle of the frame until the next call, which finishes the frame as its first one
+            batch->results[index] = CHIP8_TICK_BREAK;
+            atomic_fetch_add(&batch->paused_instance_count, 1);
+            return;
+        }
+    }
+}
+
+static void chip8_batch_run_worker(struct chip8_batch *batch, int worker_index)
+{
+    /*
+    Every worker starts with its own range of instances. Once its range is empty, it steals the remaining instances of the other workers'
+    ranges, so that a worker whose instances take longer to tick doesn't keep the others waiting.
+    */
+    for (int i = 0; i < batch->thread_count; i++) {
+        struct chip8_batch_work_range *work_range = &batch->work_ranges[(worker_index + i) % batch->thread_count];
+        while (true) {
+            int index = atomic_fetch_add(&work_range->next_index, 1);
+            if (index >= work_range->end_index) {
+                break;
+            }
+            if (batch->is_vec_step) {
+                chip8_vec_step_instance(batch, index);
+            }
+            else {
+                chip8_batch_tick_instance(batch, index);
+            }
+        }
+    }
+}
+
+static int chip8_batch_worker_main(void *argument)
+{
+    struct chip8_batch_worker *worker = argument;
+    struct chip8_batch *batch = worker->batch;
+    unsigned long finished_generation = 0;
+
+    mtx_lock(&batch->mutex);
+    while (true) {
+        while (batch->work_generation == finished_generation && !batch->is_shutting_down) {
+            cnd_wait(&batch->work_available, &batch->mutex);
+        }
+        if (batch->is_shutting_down) {
+            break;
+        }
+        finished_generation = batch->work_generation;
+        mtx_unlock(&batch->mutex);
+
+        chip8_batch_run_worker(batch, worker->worker_index);
+
+        mtx_lock(&batch->mutex);
+        batch->busy_worker_count--;
+        if (batch->busy_worker_count == 0) {
+            cnd_signal(&batch->work_finished);
+        }
+    }
+    mtx_unlock(&batch->mutex);
+    return 0;
+}
+
+static void chip8_batch_stop_threads(struct chip8_batch *batch)
+{
+    mtx_lock(&batch->mutex);
+    batch->is_shutting_down = true;
+    cnd_broadcast(&batch->work_available);
+    mtx_unlock(&batch->mutex);
+
+    for (int i = 0; i < batch->started_thread_count; i++) {
+        thrd_join(batch->threads[i], NULL);
+    }
+    batch->started_thread_count = 0;
+}
+
+struct chip8_batch *chip8_batch_create(int instance_count, int thread_count)
+{
+    if (instance_count <= 0 || thread_count <= 0) {
+        return NULL;
+    }
+
+    struct chip8_batch *batch = calloc(1, sizeof(*batch));
+    if (batch == NULL) {
+        return NULL;
+    }
+    batch->instance_count = instance_count;
+    batch->thread_count = thread_count;
+    batch->instances = calloc(instance_count, sizeof(*batch->instances));
+    batch->results = calloc(instance_count, sizeof(*batch->results));
+    batch->workers = calloc(thread_count, sizeof(*batch->workers));
+    batch->work_ranges = aligned_alloc(_Alignof(struct chip8_batch_work_range), thread_count * sizeof(*batch->work_ranges));
+    if (thread_count > 1) {
+        batch->threads = calloc(thread_count - 1, sizeof(*batch->threads));
+    }
+    if (batch->instances == NULL || batch->results == NULL || batch->workers == NULL || batch->work_ranges == NULL || (thread_count > 1 && batch->threads == NULL)) {
+        chip8_batch_destroy(batch);
+        return NULL;
+    }
+    for (int i = 0; i < thread_count; i++) {
+        atomic_init(&batch->work_ranges[i].next_index, 0);
+        batch->work_ranges[i].end_index = 0;
+        batch->workers[i].batch = batch;
+        batch->workers[i].worker_index = i;
+    }
+    atomic_init(&batch->failed_instance_count, 0);
+    atomic_init(&batch->paused_instance_count, 0);
+
+    if (mtx_init(&batch->mutex, mtx_plain) != thrd_success) {
+        chip8_batch_destroy(batch);
+        return NULL;
+    }
+    if (cnd_init(&batch->work_available) != thrd_success) {
+        mtx_destroy(&batch->mutex);
+        chip8_batch_destroy(batch);
+        return NULL;
+    }
+    if (cnd_init(&batch->work_finished) != thrd_success) {
+        cnd_destroy(&batch->work_available);
+        mtx_destroy(&batch->mutex);
+        chip8_batch_destroy(batch);
+        return NULL;
+    }
+    batch->is_synchronization_initialized = true;
+
+    // The thread calling chip8_batch_tick_frames is worker 0, so only the other workers get their own thread
+    for (int i = 1; i < thread_count; i++) {
+        if (thrd_create(&batch->threads[i - 1], chip8_batch_worker_main, &batch->workers[i]) != thrd_success) {
+            chip8_batch_destroy(batch);
+            return NULL;
+        }
+        batch->started_thread_count++;
+    }
+    return batch;
+}
+
+void chip8_batch_destroy(struct chip8_batch *batch)
+{
+    if (batch == NULL) {
+        return;
+    }
+
+    if (batch->is_synchronization_initialized) {
+        chip8_batch_stop_threads(batch);
+        mtx_destroy(&batch->mutex);
+        cnd_destroy(&batch->work_available);
+        cnd_destroy(&batch->work_finished);
+    }
+    // The instances were zero-initialized, so instances that were never initialized can be deinitialized as well
+    for (int i = 0; batch->instances != NULL && i < batch->instance_count; i++) {
+        chip8_deinitialize(&batch->instances[i]);
+    }
+    free(batch->instances);
+    free(batch->results);
+    free(batch->threads);
+    free(batch->workers);
+    free(batch->work_ranges);
+    free(batch->observation_history);
+    free(batch->reset_states);
+    free(batch->probe_values);
+    free(batch);
+}
+
+struct chip8 *chip8_batch_get_instance(struct chip8_batch *batch, int index)
+{
+    if (index < 0 || index >= batch->instance_count) {
+        return NULL;
+    }
+
+    return &batch->instances[index];
+}
+
+int chip8_batch_get_instance_count(struct chip8_batch *batch)
+{
+    return batch->instance_count;
+}
+
+static int chip8_batch_run(struct chip8_batch *batch)
+{
+    // The instances are split into one contiguous range per worker
+    for (int i = 0; i < batch->thread_count; i++) {
+        atomic_store(&batch->work_ranges[i].next_index, (int)((long long)batch->instance_count * i / batch->thread_count));
+        batch->work_ranges[i].end_index = (int)((long long)batch->instance_count * (i + 1) / batch->thread_count);
+    }
+    atomic_store(&batch->failed_instance_count, 0);
+    atomic_store(&batch->paused_instance_count, 0);
+
+    if (batch->thread_count > 1) {
+        mtx_lock(&batch->mutex);
+        batch->busy_worker_count = batch->thread_count - 1;
+        batch->work_generation++;
+        cnd_broadcast(&batch->work_available);
+        mtx_unlock(&batch->mutex);
+    }
+
+    chip8_batch_run_worker(batch, 0);
+
+    if (batch->thread_count > 1) {
+        mtx_lock(&batch->mutex);
+        while (batch->busy_worker_count > 0) {
+            cnd_wait(&batch->work_finished, &batch->mutex);
+        }
+        mtx_unlock(&batch->mutex);
+    }
+    return atomic_load(&batch->failed_instance_count);
+}
+
+int chip8_batch_tick_frames(struct chip8_batch *batch, int frames)
+{
+    batch->frames_to_tick = frames;
+    batch->is_vec_step = false;
+    return chip8_batch_run(batch);
+}
+
+int chip8_batch_get_result(struct chip8_batch *batch, int index)
+{
+    if (index < 0 || index >= batch->instance_count) {
+        return 0;
+    }
+
+    return batch->results[index];
+}
+
+int chip8_batch_get_paused_instance_count(struct chip8_batch *batch)
+{
+    return atomic_load(&batch->paused_instance_count);
+}
+
+int chip8_vec_configure(struct chip8_batch *batch, const struct chip8_vec_options *options)
+{
+    int factor = options->downsample_factor;
+    if (options->frames_per_step <= 0 || options->frame_stack <= 0 || (factor != 1 && factor != 2 && factor != 4 && factor != 8)) {
+        return 0;
+    }
+
+    batch->is_vec_configured = false;
+    batch->is_vec_reset = false;
+    free(batch->observation_history);
+    free(batch->reset_states);
+    free(batch->probe_values);
+    batch->observation_frame_size = (32 / factor) * (64 / factor);
+    batch->observation_size = batch->observation_frame_size * options->frame_stack;
+    batch->observation_history = calloc(batch->instance_count, batch->observation_size);
+    batch->reset_states = calloc(batch->instance_count, chip8_get_save_state_size());
+    batch->probe_values = calloc(batch->instance_count, CHIP8_VEC_MAXIMUM_PROBES);
+    if (batch->observation_history == NULL || batch->reset_states == NULL || batch->probe_values == NULL) {
+        return 0;
+    }
+    batch->vec_options = *options;
+    batch->is_vec_configured = true;
+    return 1;
+}
+
+size_t chip8_vec_get_observation_size(struct chip8_batch *batch)
+{
+    if (!batch->is_vec_configured) {
+        return 0;
+    }
+
+    return batch->observation_size;
+}
+
+int chip8_vec_add_probe(struct chip8_batch *batch, const struct chip8_vec_probe *probe)
+{
+    if (batch->probe_count >= CHIP8_VEC_MAXIMUM_PROBES) {
+        return 0;
+    }
+    if (probe->kind != CHIP8_VEC_PROBE_REWARD && probe->kind != CHIP8_VEC_PROBE_DONE_IF_EQUAL && probe->kind != CHIP8_VEC_PROBE_DONE_IF_NOT_EQUAL) {
+        return 0;
+    }
+    if (!(probe->location == CHIP8_VEC_PROBE_MEMORY && probe->index <= 0xFFF) && !(probe->location == CHIP8_VEC_PROBE_REGISTER && probe->index <= 0xF)) {
+        return 0;
+    }
+
+    batch->probes[batch->probe_count++] = *probe;
+    batch->is_vec_reset = false;
+    return 1;
+}
+
+void chip8_vec_clear_probes(struct chip8_batch *batch)
+{
+    batch->probe_count = 0;
+    batch->is_vec_reset = false;
+}
+
+int chip8_vec_reset(struct chip8_batch *batch, uint8_t *observations)
+{
+    if (!batch->is_vec_configured) {
+        return 0;
+    }
+
+    batch->observations = observations;
+    for (int i = 0; i < batch->instance_count; i++) {
+        chip8_save_state(&batch->instances[i], &batch->reset_states[i * chip8_get_save_state_size()], chip8_get_save_state_size());
+        chip8_vec_read_probe_values(batch, i);
+        chip8_vec_push_observation(batch, i, true);
+    }
+    batch->is_vec_reset = true;
+    return 1;
+}
+
+int chip8_vec_step(struct chip8_batch *batch, const uint16_t *actions, uint8_t *observations, float *rewards, uint8_t *dones)
+{
+    if (!batch->is_vec_configured || !batch->is_vec_reset) {
+        return -1;
+    }
+
+    batch->actions = actions;
+    batch->observations = observations;
+    batch->rewards = rewards;
+    batch->dones = dones;
+    batch->is_vec_step = true;
+    return chip8_batch_run(batch);
+}
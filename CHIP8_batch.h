@@ -0,0 +1,90 @@
+#ifndef CHIP8_BATCH
+#define CHIP8_BATCH
+
+#include <stdint.h>
+#include <stddef.h>
+#include <CHIP8.h>
+
+/*
+The batch runner owns an array of CHIP-8 instances and ticks them in parallel on a pool of worker threads.
+It requires C11 threads (threads.h) and atomics (stdatomic.h), unlike the emulator itself.
+*/
+
+struct chip8_batch;
+
+// Returns NULL if the amount of instances or threads isn't greater than 0, or if the batch couldn't be allocated. NOTE: The instances must be initialized using chip8_batch_get_instance before ticking the batch
+struct chip8_batch *chip8_batch_create(int instance_count, int thread_count);
+
+// Deinitializes every instance before freeing the batch
+void chip8_batch_destroy(struct chip8_batch *batch);
+
+// The index must be a value from 0 to the amount of instances - 1. Otherwise, the function will return NULL
+struct chip8 *chip8_batch_get_instance(struct chip8_batch *batch, int index);
+
+int chip8_batch_get_instance_count(struct chip8_batch *batch);
+
+// Ticks every instance by the given amount of frames. Returns the amount of instances that encountered an invalid instruction, which stop ticking for the rest of the call. NOTE: Instances that a breakpoint or watchpoint interrupted are paused for the rest of the call as well, and the next call finishes the interrupted frame as their first frame
+int chip8_batch_tick_frames(struct chip8_batch *batch, int frames);
+
+// Returns 0 if the instance encountered an invalid instruction during the last call to chip8_batch_tick_frames or chip8_vec_step, or if the index is invalid, and CHIP8_TICK_BREAK if a breakpoint or watchpoint paused the instance
+int chip8_batch_get_result(struct chip8_batch *batch, int index);
+
+// Returns the amount of instances that a breakpoint or watchpoint paused during the last call to chip8_batch_tick_frames or chip8_vec_step
+int chip8_batch_get_paused_instance_count(struct chip8_batch *batch);
+
+/*
+Vectorized environment API for reinforcement learning. Every step applies one key mask per instance, ticks every instance by a fixed amount of frames,
+and writes the observations, rewards and done flags of all instances into contiguous arrays. Rewards and done flags are computed from probes on the
+instances' memory or registers. Instances whose episode is done are restored to the state they had when chip8_vec_reset was called.
+*/
+
+#define CHIP8_VEC_MAXIMUM_PROBES 16
+
+enum chip8_vec_probe_kind {
+    CHIP8_VEC_PROBE_REWARD,  // Adds the change of the value since the last step, multiplied by the scale, to the reward
+    CHIP8_VEC_PROBE_DONE_IF_EQUAL,  // Ends the episode when the value equals the target
+    CHIP8_VEC_PROBE_DONE_IF_NOT_EQUAL,  // Ends the episode when the value differs from the target
+};
+
+enum chip8_vec_probe_location {
+    CHIP8_VEC_PROBE_MEMORY,  // The index is an address from 0x000 to 0xFFF
+    CHIP8_VEC_PROBE_REGISTER,  // The index is a register from 0 to F
+};
+
+struct chip8_vec_probe {
+    enum chip8_vec_probe_kind kind;
+    enum chip8_vec_probe_location location;
+    uint16_t index;
+    float scale;  // Only used by reward probes
+    uint8_t target;  // Only used by done probes
+};
+
+struct chip8_vec_options {
+    int frames_per_step;  // Must be a value greater than 0
+    int downsample_factor;  // 1, 2, 4 or 8. Each observation pixel is the average of a square of factor by factor screen pixels, from 0 to 255
+    int frame_stack;  // The amount of most recent observations per instance, oldest first. Must be a value greater than 0
+};
+
+// Returns 0 if any of the options are invalid, or if the buffers couldn't be allocated. NOTE: chip8_vec_reset must be called again before stepping
+int chip8_vec_configure(struct chip8_batch *batch, const struct chip8_vec_options *options);
+
+// Returns the size in bytes of one instance's observation, laid out as frame_stack * height * width bytes. Returns 0 if the batch isn't configured
+size_t chip8_vec_get_observation_size(struct chip8_batch *batch);
+
+// Returns 0 if the probe is invalid or CHIP8_VEC_MAXIMUM_PROBES probes were already added. NOTE: chip8_vec_reset must be called again before stepping
+int chip8_vec_add_probe(struct chip8_batch *batch, const struct chip8_vec_probe *probe);
+
+void chip8_vec_clear_probes(struct chip8_batch *batch);
+
+// Saves every instance's current state as the state episodes start from, and writes the first observations. Returns 0 if the batch isn't configured
+int chip8_vec_reset(struct chip8_batch *batch, uint8_t *observations);
+
+/*
+Applies actions[i] as the key mask of instance i, ticks every instance, and writes instance_count observations, rewards and done flags.
+An instance that encounters an invalid instruction is done. Done instances are restored, and their observation is the first one of the new episode.
+An instance that a breakpoint or watchpoint interrupts is paused for the rest of the step, and its observation, reward and probes are taken where it stopped.
+Returns the amount of instances that encountered an invalid instruction, or -1 if chip8_vec_reset wasn't called since the batch was configured
+*/
+int chip8_vec_step(struct chip8_batch *batch, const uint16_t *actions, uint8_t *observations, float *rewards, uint8_t *dones);
+
+#endif
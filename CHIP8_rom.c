@@ -0,0 +1,127 @@
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L
+#define CHIP8_ROM_USE_MMAP
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <CHIP8.h>
+#include <CHIP8_rom.h>
+
+#ifdef CHIP8_ROM_USE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+struct chip8_rom {
+    const uint8_t *data;
+    size_t size;
+    bool is_mapped;  // The data is unmapped when true, and freed otherwise
+};
+
+static bool chip8_rom_read_file(struct chip8_rom *rom, const char *file_path)
+{
+    FILE *file = fopen(file_path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    // One byte more than fits in memory is read, so that oversized programs are detected
+    uint8_t *data = malloc(CHIP8_MAXIMUM_PROGRAM_SIZE + 1);
+    if (data == NULL) {
+        fclose(file);
+        return false;
+    }
+    size_t size = fread(data, 1, CHIP8_MAXIMUM_PROGRAM_SIZE + 1, file);
+    bool is_read_successful = !ferror(file);
+    fclose(file);
+    if (!is_read_successful || size > CHIP8_MAXIMUM_PROGRAM_SIZE) {
+        free(data);
+        return false;
+    }
+
+    rom->data = data;
+    rom->size = size;
+    rom->is_mapped = false;
+    return true;
+}
+
+#ifdef CHIP8_ROM_USE_MMAP
+static bool chip8_rom_map_file(struct chip8_rom *rom, const char *file_path)
+{
+    int file_descriptor = open(file_path, O_RDONLY);
+    if (file_descriptor == -1) {
+        return false;
+    }
+    struct stat file_status;
+    if (fstat(file_descriptor, &file_status) == -1 || !S_ISREG(file_status.st_mode) || file_status.st_size == 0 || file_status.st_size > CHIP8_MAXIMUM_PROGRAM_SIZE) {
+        close(file_descriptor);
+        return false;
+    }
+    void *data = mmap(NULL, file_status.st_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor);  // The mapping stays valid after the file is closed
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    rom->data = data;
+    rom->size = file_status.st_size;
+    rom->is_mapped = true;
+    return true;
+}
+#endif
+
+struct chip8_rom *chip8_rom_open(const char *file_path)
+{
+    struct chip8_rom *rom = malloc(sizeof(*rom));
+    if (rom == NULL) {
+        return NULL;
+    }
+
+#ifdef CHIP8_ROM_USE_MMAP
+    if (chip8_rom_map_file(rom, file_path)) {
+        return rom;
+    }
+#endif
+    // Files that can't be mapped, such as empty files and pipes, are read instead
+    if (!chip8_rom_read_file(rom, file_path)) {
+        free(rom);
+        return NULL;
+    }
+    return rom;
+}
+
+void chip8_rom_close(struct chip8_rom *rom)
+{
+    if (rom == NULL) {
+        return;
+    }
+
+#ifdef CHIP8_ROM_USE_MMAP
+    if (rom->is_mapped) {
+        munmap((void *)rom->data, rom->size);
+        free(rom);
+        return;
+    }
+#endif
+    free((void *)rom->data);
+    free(rom);
+}
+
+const uint8_t *chip8_rom_get_data(struct chip8_rom *rom)
+{
+    return rom->data;
+}
+
+size_t chip8_rom_get_size(struct chip8_rom *rom)
+{
+    return rom->size;
+}
+
+int chip8_load_program_from_rom(struct chip8 *chip8, struct chip8_rom *rom)
+{
+    return chip8_load_program_from_buffer(chip8, rom->data, rom->size);
+}
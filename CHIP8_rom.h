@@ -0,0 +1,27 @@
+#ifndef CHIP8_ROM
+#define CHIP8_ROM
+
+#include <stddef.h>
+#include <stdint.h>
+#include <CHIP8.h>
+
+/*
+A ROM holds the contents of a program file, so that many instances can load the same program without reading the file again.
+On Unix-like systems the file is memory-mapped and shared read-only, and elsewhere it is read into memory once.
+*/
+
+struct chip8_rom;
+
+// Returns NULL if the file couldn't be opened or read, or if it is larger than CHIP8_MAXIMUM_PROGRAM_SIZE
+struct chip8_rom *chip8_rom_open(const char *file_path);
+
+void chip8_rom_close(struct chip8_rom *rom);
+
+const uint8_t *chip8_rom_get_data(struct chip8_rom *rom);
+
+size_t chip8_rom_get_size(struct chip8_rom *rom);
+
+// Same as chip8_load_program_from_buffer with the ROM's contents. The ROM can be closed afterwards
+int chip8_load_program_from_rom(struct chip8 *chip8, struct chip8_rom *rom);
+
+#endif
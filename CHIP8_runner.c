@@ -0,0 +1,214 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <threads.h>
+#include <stdatomic.h>
+#include <CHIP8.h>
+#include <CHIP8_runner.h>
+
+#define CHIP8_RUNNER_FRAME_NANOSECONDS (1000000000LL / CHIP8_RUNNER_FRAMES_PER_SECOND)
+#define CHIP8_RUNNER_MAXIMUM_LAG_FRAMES 4  // When the emulation thread falls further behind than this, it skips ahead instead of catching up
+#define CHIP8_RUNNER_FRESH_FRAME 0x4  // Set in middle_frame_index while the middle frame hasn't been acquired
+
+struct chip8_runner_key_event {
+    uint8_t key_value;
+    bool new_state;
+};
+
+struct chip8_runner {
+    struct chip8 *chip8;
+    thrd_t thread;
+    bool is_thread_started;
+    atomic_bool is_running;
+    atomic_bool is_stop_requested;
+    atomic_int result;
+
+    /*
+    Triple buffer. The emulation thread owns the back frame and the host owns the front frame, and each of them swaps its frame with the middle frame.
+    Publishing marks the middle frame as fresh, and the host only swaps with the middle frame when it is fresh, so neither side ever waits for the other.
+    */
+    struct chip8_runner_frame frames[3];
+    _Alignas(64) atomic_uint middle_frame_index;
+    _Alignas(64) unsigned int back_frame_index;
+    uint64_t frame_number;
+    _Alignas(64) unsigned int front_frame_index;
+
+    // Single-producer, single-consumer queue. The host only writes the tail and the emulation thread only writes the head
+    struct chip8_runner_key_event key_events[CHIP8_RUNNER_KEY_QUEUE_SIZE];
+    _Alignas(64) atomic_uint key_event_head;
+    _Alignas(64) atomic_uint key_event_tail;
+};
+
+static long long chip8_runner_get_time(void)
+{
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+static void chip8_runner_apply_key_events(struct chip8_runner *runner)
+{
+    unsigned int head = atomic_load_explicit(&runner->key_event_head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&runner->key_event_tail, memory_order_acquire);
+    // A key only changes once per frame, so that a press and release pushed between two frames is still seen by FX0A
+    uint16_t changed_keys = 0;
+    while (head != tail) {
+        const struct chip8_runner_key_event *key_event = &runner->key_events[head & (CHIP8_RUNNER_KEY_QUEUE_SIZE - 1)];
+        if (changed_keys & (1 << key_event->key_value)) {
+            break;
+        }
+        chip8_set_key_state(runner->chip8, key_event->key_value, key_event->new_state);
+        changed_keys |= 1 << key_event->key_value;
+        head++;
+    }
+    atomic_store_explicit(&runner->key_event_head, head, memory_order_release);
+}
+
+static void chip8_runner_publish_frame(struct chip8_runner *runner)
+{
+    struct chip8_runner_frame *frame = &runner->frames[runner->back_frame_index];
+    memcpy(frame->screen_rows, chip8_get_screen_rows(runner->chip8), sizeof(frame->screen_rows));
+    frame->dirty_rows = chip8_get_dirty_rows(runner->chip8);
+    frame->should_sound_play = chip8_should_sound_play(runner->chip8);
+    frame->is_idle = chip8_is_idle(runner->chip8);
+    frame->frame_number = ++runner->frame_number;
+
+    unsigned int previous_middle_frame_index = atomic_exchange_explicit(&runner->middle_frame_index, runner->back_frame_index | CHIP8_RUNNER_FRESH_FRAME, memory_order_acq_rel);
+    runner->back_frame_index = previous_middle_frame_index & ~CHIP8_RUNNER_FRESH_FRAME;
+}
+
+static int chip8_runner_main(void *argument)
+{
+    struct chip8_runner *runner = argument;
+    long long next_frame_time = chip8_runner_get_time();
+    while (!atomic_load_explicit(&runner->is_stop_requested, memory_order_acquire)) {
+        chip8_runner_apply_key_events(runner);
+        int result = chip8_tick_frame(runner->chip8);
+        if (result != 1) {
+            // An invalid instruction stops the runner, and so does a breakpoint or watchpoint, so that the host can inspect the instance
+            // once chip8_runner_stop returns. Starting the runner again finishes the interrupted frame
+            atomic_store(&runner->result, result);
+            break;
+        }
+        chip8_runner_publish_frame(runner);
+
+        // Frames are paced against absolute deadlines, so that the time spent ticking doesn't add up to a slower frame rate
+        next_frame_time += CHIP8_RUNNER_FRAME_NANOSECONDS;
+        long long current_time = chip8_runner_get_time();
+        if (current_time - next_frame_time > CHIP8_RUNNER_MAXIMUM_LAG_FRAMES * CHIP8_RUNNER_FRAME_NANOSECONDS || next_frame_time - current_time > CHIP8_RUNNER_FRAME_NANOSECONDS) {
+            next_frame_time = current_time;  // Fell too far behind, or the clock was changed
+        }
+        else if (next_frame_time > current_time) {
+            long long sleep_time = next_frame_time - current_time;
+            struct timespec duration = {.tv_sec = sleep_time / 1000000000LL, .tv_nsec = sleep_time % 1000000000LL};
+            thrd_sleep(&duration, NULL);
+        }
+    }
+    atomic_store_explicit(&runner->is_running, false, memory_order_release);
+    return 0;
+}
+
+struct chip8_runner *chip8_runner_create(struct chip8 *chip8)
+{
+    struct chip8_runner *runner = aligned_alloc(_Alignof(struct chip8_runner), sizeof(*runner));
+    if (runner == NULL) {
+        return NULL;
+    }
+    memset(runner, 0x00, sizeof(*runner));
+    runner->chip8 = chip8;
+    runner->is_thread_started = false;
+    atomic_init(&runner->is_running, false);
+    atomic_init(&runner->is_stop_requested, false);
+    atomic_init(&runner->result, 1);
+    runner->front_frame_index = 0;
+    atomic_init(&runner->middle_frame_index, 1);
+    runner->back_frame_index = 2;
+    runner->frame_number = 0;
+    atomic_init(&runner->key_event_head, 0);
+    atomic_init(&runner->key_event_tail, 0);
+    return runner;
+}
+
+void chip8_runner_destroy(struct chip8_runner *runner)
+{
+    if (runner == NULL) {
+        return;
+    }
+
+    chip8_runner_stop(runner);
+    free(runner);
+}
+
+int chip8_runner_start(struct chip8_runner *runner)
+{
+    if (runner->is_thread_started) {
+        return 0;
+    }
+
+    atomic_store(&runner->is_stop_requested, false);
+    atomic_store(&runner->result, 1);
+    atomic_store(&runner->is_running, true);
+    if (thrd_create(&runner->thread, chip8_runner_main, runner) != thrd_success) {
+        atomic_store(&runner->is_running, false);
+        return 0;
+    }
+    runner->is_thread_started = true;
+    return 1;
+}
+
+void chip8_runner_stop(struct chip8_runner *runner)
+{
+    if (!runner->is_thread_started) {
+        return;
+    }
+
+    atomic_store_explicit(&runner->is_stop_requested, true, memory_order_release);
+    thrd_join(runner->thread, NULL);
+    runner->is_thread_started = false;
+}
+
+bool chip8_runner_is_running(struct chip8_runner *runner)
+{
+    return atomic_load_explicit(&runner->is_running, memory_order_acquire);
+}
+
+int chip8_runner_get_result(struct chip8_runner *runner)
+{
+    return atomic_load(&runner->result);
+}
+
+int chip8_runner_push_key_event(struct chip8_runner *runner, int key_value, bool new_state)
+{
+    if (key_value < 0x0 || key_value > 0xF) {
+        return 0;
+    }
+
+    unsigned int tail = atomic_load_explicit(&runner->key_event_tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&runner->key_event_head, memory_order_acquire);
+    if (tail - head == CHIP8_RUNNER_KEY_QUEUE_SIZE) {
+        return 0;
+    }
+    struct chip8_runner_key_event *key_event = &runner->key_events[tail & (CHIP8_RUNNER_KEY_QUEUE_SIZE - 1)];
+    key_event->key_value = key_value;
+    key_event->new_state = new_state;
+    atomic_store_explicit(&runner->key_event_tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+const struct chip8_runner_frame *chip8_runner_acquire_frame(struct chip8_runner *runner)
+{
+    if (atomic_load_explicit(&runner->middle_frame_index, memory_order_relaxed) & CHIP8_RUNNER_FRESH_FRAME) {
+        unsigned int previous_middle_frame_index = atomic_exchange_explicit(&runner->middle_frame_index, runner->front_frame_index, memory_order_acq_rel);
+        runner->front_frame_index = previous_middle_frame_index & ~CHIP8_RUNNER_FRESH_FRAME;
+    }
+    return &runner->frames[runner->front_frame_index];
+}
+
+bool chip8_runner_get_pixel(const struct chip8_runner_frame *frame, int x, int y)
+{
+    if (x < 0 | x >= 64 | y < 0 | y >= 32) {
+        return false;
+    }
+
+    return (frame->screen_rows[y] >> (63 - x)) & 1;
+}
@@ -0,0 +1,53 @@
+#ifndef CHIP8_RUNNER
+#define CHIP8_RUNNER
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <CHIP8.h>
+
+/*
+The runner ticks a CHIP-8 instance on its own emulation thread at 60 frames per second. Finished frames are published through a lock-free triple buffer,
+and key events are passed to the emulation thread through a lock-free single-producer, single-consumer queue, so the host never has to lock the instance.
+It requires C11 threads (threads.h) and atomics (stdatomic.h), unlike the emulator itself.
+*/
+
+#define CHIP8_RUNNER_FRAMES_PER_SECOND 60
+#define CHIP8_RUNNER_KEY_QUEUE_SIZE 64  // Must be a power of 2
+
+struct chip8_runner;
+
+struct chip8_runner_frame {
+    uint64_t screen_rows[32];  // Same layout as chip8_get_screen_rows
+    uint32_t dirty_rows;  // Rows that changed since frame frame_number - 1. Every row should be redrawn when frames were skipped between two acquired frames
+    bool should_sound_play;
+    bool is_idle;
+    uint64_t frame_number;  // 1 for the first frame. 0 until the first frame is published
+};
+
+// Returns NULL if the runner couldn't be allocated. NOTE: The instance must be initialized and have a program loaded, and must not be accessed by the host between chip8_runner_start and chip8_runner_stop
+struct chip8_runner *chip8_runner_create(struct chip8 *chip8);
+
+// Stops the runner if it is running
+void chip8_runner_destroy(struct chip8_runner *runner);
+
+// Returns 0 if the emulation thread couldn't be started, or if the runner is already running
+int chip8_runner_start(struct chip8_runner *runner);
+
+// Waits for the emulation thread to finish its current frame and exit. Key events that weren't applied yet stay queued
+void chip8_runner_stop(struct chip8_runner *runner);
+
+// Returns false once the emulation thread stopped, including when the instance encountered an invalid instruction or a breakpoint or watchpoint
+bool chip8_runner_is_running(struct chip8_runner *runner);
+
+// Returns 0 if the instance encountered an invalid instruction, and CHIP8_TICK_BREAK if a breakpoint or watchpoint paused it in the middle of a frame, which starting the runner again finishes
+int chip8_runner_get_result(struct chip8_runner *runner);
+
+// Must only be called from one thread at a time. Returns 0 if the key value is invalid or the queue is full. NOTE: Events are applied at the start of the next frame
+int chip8_runner_push_key_event(struct chip8_runner *runner, int key_value, bool new_state);
+
+// Returns the most recently published frame, which stays valid and unchanged until the next call. Must only be called from one thread at a time
+const struct chip8_runner_frame *chip8_runner_acquire_frame(struct chip8_runner *runner);
+
+bool chip8_runner_get_pixel(const struct chip8_runner_frame *frame, int x, int y);
+
+#endif
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <CHIP8.h>
+
+/*
+Headless benchmark for the emulator core. Every program is a synthetic ROM that loops forever over one class of instructions,
+and is ticked as fast as possible without frame pacing. Results are written as CSV or JSON lines, one line per program and engine.
+*/
+
+#define CHIP8_BENCH_MAXIMUM_PROGRAM_SIZE 256
+#define CHIP8_BENCH_CALL_DEPTH 15  // The stack holds 16 return addresses
+#define CHIP8_BENCH_ARRAY_LENGTH(array) ((int)(sizeof(array) / sizeof(*(array))))
+
+struct chip8_bench_program {
+    const char *name;
+    uint16_t instructions[CHIP8_BENCH_MAXIMUM_PROGRAM_SIZE / 2];
+    int instruction_count;
+    bool toggles_keys;  // Presses and releases key 0 on alternate frames, for programs waiting on FX0A
+    bool is_draw_bound;  // Runs with the CHIP-48 quirks instead of the COSMAC VIP's, whose DXYN waits for vblank and would only draw once per frame
+};
+
+struct chip8_bench_result {
+    long long instruction_count;
+    int frame_count;
+    double seconds;
+};
+
+static struct chip8_bench_program chip8_bench_programs[] = {
+    {
+        .name = "alu",
+        .instructions = {
+            0x6001, 0x6102, 0x6203, 0x6304,
+            0x8014, 0x8125, 0x8231, 0x8302, 0x8413, 0x8016, 0x810E, 0x7001, 0x7102, 0x8540,
+            0x3555, 0x7301, 0x4066, 0x7401,
+            0x1208,
+        },
+        .instruction_count = 19,
+    },
+    {
+        .name = "draw",
+        .instructions = {
+            0x6000, 0x6100, 0xA000,
+            0xD015, 0x7008, 0x7103,
+            0x1206,
+        },
+        .instruction_count = 7,
+        .is_draw_bound = true,
+    },
+    {
+        .name = "call",  // Filled in by chip8_bench_build_call_program
+    },
+    {
+        .name = "memory",
+        .instructions = {
+            0xA300, 0xFF55, 0xA300, 0xFF65, 0x7001,
+            0x1200,
+        },
+        .instruction_count = 6,
+    },
+    {
+        .name = "key_wait",
+        .instructions = {
+            0x6000,
+            0xF00A, 0x7101,
+            0x1202,
+        },
+        .instruction_count = 4,
+        .toggles_keys = true,
+    },
+};
+
+static void chip8_bench_build_call_program(struct chip8_bench_program *program)
+{
+    // A loop calling a chain of subroutines, each of which calls the next one and then returns
+    uint16_t *instruction = program->instructions;
+    *instruction++ = 0x2204;
+    *instruction++ = 0x1200;
+    for (int depth = 1; depth <= CHIP8_BENCH_CALL_DEPTH; depth++) {
+        uint16_t next_subroutine_address = 0x0200 + (depth + 1) * 4;
+        *instruction++ = (depth < CHIP8_BENCH_CALL_DEPTH) ? (0x2000 | next_subroutine_address) : 0x7001;
+        *instruction++ = 0x00EE;
+    }
+    program->instruction_count = instruction - program->instructions;
+}
+
+static double chip8_bench_get_seconds(void)
+{
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static int chip8_bench_run(const struct chip8_bench_program *program, enum chip8_execution_engine execution_engine, enum chip8_quirk_profile quirk_profile, int instructions_per_frame,
+                           int frame_count, struct chip8_bench_result *result)
+{
+    static struct chip8 chip8;
+    struct chip8_options options = {
+        .instructions_per_frame = instructions_per_frame,
+        .execution_engine = execution_engine,
+        .quirk_profile = quirk_profile,
+    };
+    if (!chip8_initialize_with_options(&chip8, &options)) {
+        return 0;
+    }
+    uint8_t program_bytes[CHIP8_BENCH_MAXIMUM_PROGRAM_SIZE];
+    for (int i = 0; i < program->instruction_count; i++) {
+        program_bytes[i * 2] = program->instructions[i] >> 8;
+        program_bytes[i * 2 + 1] = program->instructions[i] & 0xFF;
+    }
+    if (!chip8_load_program_from_buffer(&chip8, program_bytes, program->instruction_count * 2)) {
+        chip8_deinitialize(&chip8);
+        return 0;
+    }
+
+    // Instructions skipped by ending frames early aren't counted, so that idle programs don't report impossible instruction rates
+    long long skipped_instruction_count = 0;
+    double start_time = chip8_bench_get_seconds();
+    for (int frame = 0; frame < frame_count; frame++) {
+        if (program->toggles_keys) {
+            chip8_set_key_state(&chip8, 0x0, frame % 2 == 0);
+        }
+        if (!chip8_tick_frame(&chip8)) {
+            chip8_deinitialize(&chip8);
+            return 0;
+        }
+        skipped_instruction_count += chip8_get_skipped_instruction_count(&chip8);
+    }
+    result->seconds = chip8_bench_get_seconds() - start_time;
+    result->frame_count = frame_count;
+    result->instruction_count = (long long)frame_count * instructions_per_frame - skipped_instruction_count;
+    chip8_deinitialize(&chip8);
+    return 1;
+}
+
+static void chip8_bench_print_result(const char *format, const char *program_name, const char *engine_name, const char *quirks_name, int instructions_per_frame,
+                                     const struct chip8_bench_result *result)
+{
+    double instructions_per_second = result->instruction_count / result->seconds;
+    double frames_per_second = result->frame_count / result->seconds;
+    double nanoseconds_per_instruction = result->instruction_count > 0 ? result->seconds * 1e9 / result->instruction_count : 0.0;
+    if (strcmp(format, "json") == 0) {
+        printf("{\"program\":\"%s\",\"engine\":\"%s\",\"quirks\":\"%s\",\"instructions_per_frame\":%d,\"frames\":%d,\"instructions\":%lld,\"seconds\":%.6f,"
+               "\"instructions_per_second\":%.0f,\"frames_per_second\":%.1f,\"ns_per_instruction\":%.3f}\n",
+               program_name, engine_name, quirks_name, instructions_per_frame, result->frame_count, result->instruction_count, result->seconds,
+               instructions_per_second, frames_per_second, nanoseconds_per_instruction);
+    }
+    else {
+        printf("%s,%s,%s,%d,%d,%lld,%.6f,%.0f,%.1f,%.3f\n", program_name, engine_name, quirks_name, instructions_per_frame, result->frame_count, result->instruction_count,
+               result->seconds, instructions_per_second, frames_per_second, nanoseconds_per_instruction);
+    }
+}
+
+static void chip8_bench_print_usage(const char *program_path)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --frames N          Frames to tick per program (default 20000)\n"
+            "  --ipf N             Instructions per frame (default 100)\n"
+            "  --repeat N          Runs per program, of which the fastest is reported (default 3)\n"
+            "  --engine NAME       interpreter, threaded or all (default all)\n"
+            "  --quirks NAME       vip, chip48, superchip or all (default vip)\n"
+            "  --program NAME      alu, draw, call, memory, key_wait or all (default all)\n"
+            "  --format NAME       csv or json (default csv)\n",
+            program_path);
+}
+
+int main(int argc, char **argv)
+{
+    int frame_count = 20000;
+    int instructions_per_frame = 100;
+    int repeat_count = 3;
+    const char *engine_filter = "all";
+    const char *quirks_filter = "vip";
+    const char *program_filter = "all";
+    const char *format = "csv";
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            chip8_bench_print_usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--frames") == 0) {
+            frame_count = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--ipf") == 0) {
+            instructions_per_frame = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--repeat") == 0) {
+            repeat_count = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--engine") == 0) {
+            engine_filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--quirks") == 0) {
+            quirks_filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--program") == 0) {
+            program_filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--format") == 0) {
+            format = argv[++i];
+        }
+        else {
+            chip8_bench_print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (frame_count <= 0 || instructions_per_frame <= 0 || repeat_count <= 0 || (strcmp(format, "csv") != 0 && strcmp(format, "json") != 0)) {
+        chip8_bench_print_usage(argv[0]);
+        return 1;
+    }
+
+    for (int i = 0; i < CHIP8_BENCH_ARRAY_LENGTH(chip8_bench_programs); i++) {
+        if (strcmp(chip8_bench_programs[i].name, "call") == 0) {
+            chip8_bench_build_call_program(&chip8_bench_programs[i]);
+        }
+    }
+
+    const char *engine_names[] = {"interpreter", "threaded"};
+    const enum chip8_execution_engine engines[] = {CHIP8_ENGINE_INTERPRETER, CHIP8_ENGINE_THREADED};
+    const char *quirks_names[] = {"vip", "chip48", "superchip"};
+    const enum chip8_quirk_profile quirk_profiles[] = {CHIP8_QUIRKS_VIP, CHIP8_QUIRKS_CHIP48, CHIP8_QUIRKS_SUPERCHIP};
+    if (strcmp(format, "csv") == 0) {
+        printf("program,engine,quirks,instructions_per_frame,frames,instructions,seconds,instructions_per_second,frames_per_second,ns_per_instruction\n");
+    }
+    for (int i = 0; i < CHIP8_BENCH_ARRAY_LENGTH(chip8_bench_programs); i++) {
+        const struct chip8_bench_program *program = &chip8_bench_programs[i];
+        if (strcmp(program_filter, "all") != 0 && strcmp(program_filter, program->name) != 0) {
+            continue;
+        }
+        for (int engine = 0; engine < CHIP8_BENCH_ARRAY_LENGTH(engines); engine++) {
+            if (strcmp(engine_filter, "all") != 0 && strcmp(engine_filter, engine_names[engine]) != 0) {
+                continue;
+            }
+            for (int quirks = 0; quirks < CHIP8_BENCH_ARRAY_LENGTH(quirk_profiles); quirks++) {
+                if (strcmp(quirks_filter, "all") != 0 && strcmp(quirks_filter, quirks_names[quirks]) != 0) {
+                    continue;
+                }
+                int run_quirks = quirks;
+                if (program->is_draw_bound && quirk_profiles[quirks] == CHIP8_QUIRKS_VIP) {
+                    if (strcmp(quirks_filter, "all") == 0) {
+                        continue;  // The CHIP-48 run is reported instead
+                    }
+                    run_quirks = 1;  // The index of the CHIP-48 profile
+                }
+
+                struct chip8_bench_result fastest_result;
+                for (int run = 0; run < repeat_count; run++) {
+                    struct chip8_bench_result result;
+                    if (!chip8_bench_run(program, engines[engine], quirk_profiles[run_quirks], instructions_per_frame, frame_count, &result)) {
+                        fprintf(stderr, "%s: invalid instruction encountered\n", program->name);
+                        return 1;
+                    }
+                    if (run == 0 || result.seconds < fastest_result.seconds) {
+                        fastest_result = result;
+                    }
+                }
+                chip8_bench_print_result(format, program->name, engine_names[engine], quirks_names[run_quirks], instructions_per_frame, &fastest_result);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,1094 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <threads.h>
+#include <CHIP8.h>
+#include <CHIP8_batch.h>
+#include <CHIP8_runner.h>
+
+/*
+Regression tests for the emulator core, run by ctest. Each test is selected by name on the command line, and every test runs when no
+name is given. States are compared through chip8_save_state, which covers everything a program can observe.
+*/
+
+#define CHIP8_TESTS_MAXIMUM_PROGRAM_SIZE 64
+#define CHIP8_TESTS_FRAME_COUNT 300
+#define CHIP8_TESTS_ARRAY_LENGTH(array) ((int)(sizeof(array) / sizeof(*(array))))
+
+struct chip8_tests_program {
+    const char *name;
+    uint8_t bytes[CHIP8_TESTS_MAXIMUM_PROGRAM_SIZE];
+    int size;
+};
+
+static const struct chip8_tests_program chip8_tests_programs[] = {
+    {
+        .name = "alu",
+        .bytes = {
+            0x60, 0x01, 0x61, 0x02, 0x62, 0x03, 0x63, 0x04,
+            0x80, 0x14, 0x81, 0x25, 0x82, 0x31, 0x83, 0x02, 0x84, 0x13, 0x80, 0x16, 0x81, 0x0E, 0x70, 0x01, 0x71, 0x02, 0x85, 0x40,
+            0x35, 0x55, 0x73, 0x01, 0x40, 0x66, 0x74, 0x01,
+            0x12, 0x08,
+        },
+        .size = 38,
+    },
+    {
+        // Calls a chain of 3 subroutines, the last of which also returns early through a skip
+        .name = "call",
+        .bytes = {
+            0x22, 0x04, 0x12, 0x00,
+            0x22, 0x08, 0x00, 0xEE,
+            0x22, 0x0C, 0x00, 0xEE,
+            0x70, 0x01, 0x30, 0x10, 0x00, 0xEE, 0x71, 0x01, 0x00, 0xEE,
+        },
+        .size = 22,
+    },
+    {
+        .name = "memory",
+        .bytes = {
+            0xA3, 0x00, 0xFF, 0x55, 0xA3, 0x00, 0xFF, 0x65, 0x70, 0x01,
+            0x12, 0x00,
+        },
+        .size = 12,
+    },
+    {
+        // Rewrites the operand of the 7301 instruction at 0x20C on every iteration, right before executing it
+        .name = "self_modifying",
+        .bytes = {
+            0x60, 0x73, 0x61, 0x00,
+            0x71, 0x01, 0xA2, 0x0C, 0xF1, 0x55, 0x62, 0x00, 0x73, 0x01,
+            0x12, 0x04,
+        },
+        .size = 16,
+    },
+    {
+        // Draws random font sprites across the screen, and clears it every few rows
+        .name = "draw",
+        .bytes = {
+            0x60, 0x00, 0x61, 0x00,
+            0xC2, 0xFF, 0xF2, 0x29, 0xD0, 0x15, 0x70, 0x05, 0x30, 0x3C, 0x12, 0x04,
+            0x60, 0x00, 0x71, 0x06, 0x31, 0x18, 0x12, 0x04,
+            0x00, 0xE0, 0x61, 0x00, 0x12, 0x04,
+        },
+        .size = 30,
+    },
+    {
+        // Polls the delay timer until it runs out, which ends frames early
+        .name = "timer",
+        .bytes = {
+            0x60, 0x03, 0xF0, 0x15,
+            0xF1, 0x07, 0x31, 0x00, 0x12, 0x04,
+            0x72, 0x01, 0xF0, 0x18, 0x12, 0x00,
+        },
+        .size = 16,
+    },
+    {
+        .name = "key_wait",
+        .bytes = {
+            0x60, 0x00,
+            0xF0, 0x0A, 0x71, 0x01,
+            0x12, 0x02,
+        },
+        .size = 8,
+    },
+    {
+        // Jumps to an odd address, whose instructions aren't cached
+        .name = "odd_address",
+        .bytes = {
+            0x12, 0x03, 0x00, 0x60, 0x05, 0x70, 0x01, 0x12, 0x03,
+        },
+        .size = 9,
+    },
+};
+
+static const enum chip8_quirk_profile chip8_tests_quirk_profiles[] = {CHIP8_QUIRKS_VIP, CHIP8_QUIRKS_CHIP48, CHIP8_QUIRKS_SUPERCHIP};
+static const int chip8_tests_instructions_per_frame[] = {1, 7, 200};
+
+static int chip8_tests_initialize(struct chip8 *chip8, const struct chip8_tests_program *program, int instructions_per_frame, enum chip8_execution_engine execution_engine, enum chip8_quirk_profile quirk_profile)
+{
+    struct chip8_options options = {
+        .instructions_per_frame = instructions_per_frame,
+        .execution_engine = execution_engine,
+        .quirk_profile = quirk_profile,
+    };
+    if (!chip8_initialize_with_options(chip8, &options)) {
+        return 0;
+    }
+    chip8_seed_random(chip8, 1234);
+    return chip8_load_program_from_buffer(chip8, program->bytes, program->size);
+}
+
+static int chip8_tests_tick_frame(struct chip8 *chip8, int frame)
+{
+    // Key 0 is pressed and released on alternate frames, for programs waiting on FX0A
+    chip8_set_key_state(chip8, 0x0, frame % 2 == 0);
+    return chip8_tick_frame(chip8);
+}
+
+static const struct chip8_tests_program *chip8_tests_find_program(const char *name)
+{
+    for (int i = 0; i < CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs); i++) {
+        if (strcmp(chip8_tests_programs[i].name, name) == 0) {
+            return &chip8_tests_programs[i];
+        }
+    }
+    return NULL;
+}
+
+static bool chip8_tests_are_states_equal(struct chip8 *chip8, struct chip8 *other_chip8)
+{
+    size_t state_size = chip8_get_save_state_size();
+    uint8_t *state = malloc(state_size);
+    uint8_t *other_state = malloc(state_size);
+    bool is_equal = state != NULL && other_state != NULL && chip8_save_state(chip8, state, state_size) && chip8_save_state(other_chip8, other_state, state_size) &&
+        memcmp(state, other_state, state_size) == 0;
+    free(state);
+    free(other_state);
+    return is_equal;
+}
+
+// Files written by the tests are named after the test executable, so that the instrumented tests can run alongside the others
+static const char *chip8_tests_executable_path = "chip8_tests";
+
+static void chip8_tests_get_file_path(char *buffer, size_t buffer_size, const char *extension)
+{
+    snprintf(buffer, buffer_size, "%s.%s", chip8_tests_executable_path, extension);
+}
+
+// Reports the check as failed unless the condition holds, and returns 1 if it failed, so that failures can be summed up
+static int chip8_tests_check(bool condition, const char *test_name, const char *description)
+{
+    if (!condition) {
+        fprintf(stderr, "FAIL %s: %s\n", test_name, description);
+    }
+    return !condition;
+}
+
+static int chip8_tests_engines(void)
+{
+    /*
+    Runs every program with both execution engines, and with the threaded engine loaded from a program image, and checks that their
+    states match after every frame.
+    */
+    size_t state_size = chip8_get_save_state_size();
+    uint8_t *interpreter_state = malloc(state_size);
+    uint8_t *threaded_state = malloc(state_size);
+    uint8_t *image_state = malloc(state_size);
+    static struct chip8 interpreter, threaded, image_threaded;
+    int failure_count = 0;
+    for (int program_index = 0; program_index < CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs); program_index++) {
+        const struct chip8_tests_program *program = &chip8_tests_programs[program_index];
+        for (int profile_index = 0; profile_index < CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_quirk_profiles); profile_index++) {
+            enum chip8_quirk_profile quirk_profile = chip8_tests_quirk_profiles[profile_index];
+            for (int ipf_index = 0; ipf_index < CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_instructions_per_frame); ipf_index++) {
+                int instructions_per_frame = chip8_tests_instructions_per_frame[ipf_index];
+                struct chip8_image *image = chip8_image_create(program->bytes, program->size, quirk_profile);
+                if (image == NULL ||
+                    !chip8_tests_initialize(&interpreter, program, instructions_per_frame, CHIP8_ENGINE_INTERPRETER, quirk_profile) ||
+                    !chip8_tests_initialize(&threaded, program, instructions_per_frame, CHIP8_ENGINE_THREADED, quirk_profile) ||
+                    !chip8_tests_initialize(&image_threaded, program, instructions_per_frame, CHIP8_ENGINE_THREADED, quirk_profile) ||
+                    !chip8_load_image(&image_threaded, image)) {
+                    fprintf(stderr, "FAIL engines %s: couldn't load the program\n", program->name);
+                    failure_count++;
+                }
+                else {
+                    chip8_seed_random(&image_threaded, 1234);
+                    for (int frame = 0; frame < CHIP8_TESTS_FRAME_COUNT; frame++) {
+                        int interpreter_result = chip8_tests_tick_frame(&interpreter, frame);
+                        int threaded_result = chip8_tests_tick_frame(&threaded, frame);
+                        int image_result = chip8_tests_tick_frame(&image_threaded, frame);
+                        chip8_save_state(&interpreter, interpreter_state, state_size);
+                        chip8_save_state(&threaded, threaded_state, state_size);
+                        chip8_save_state(&image_threaded, image_state, state_size);
+                        if (interpreter_result != threaded_result || interpreter_result != image_result ||
+                            memcmp(interpreter_state, threaded_state, state_size) != 0 || memcmp(interpreter_state, image_state, state_size) != 0 ||
+                            chip8_get_skipped_instruction_count(&interpreter) != chip8_get_skipped_instruction_count(&threaded) ||
+                            chip8_get_skipped_instruction_count(&interpreter) != chip8_get_skipped_instruction_count(&image_threaded)) {
+                            fprintf(stderr, "FAIL engines %s: quirk profile %d, %d instructions per frame, the engines differ at frame %d\n",
+                                program->name, quirk_profile, instructions_per_frame, frame);
+                            failure_count++;
+                            break;
+                        }
+                        if (interpreter_result != 1) {
+                            break;
+                        }
+                    }
+                }
+                chip8_deinitialize(&interpreter);
+                chip8_deinitialize(&threaded);
+                chip8_deinitialize(&image_threaded);
+                chip8_image_destroy(image);
+            }
+        }
+    }
+    free(interpreter_state);
+    free(threaded_state);
+    free(image_state);
+    return failure_count == 0;
+}
+
+static int chip8_tests_save_state(void)
+{
+    // Saves a state halfway through, and checks that loading it into another CHIP-8 continues exactly as the original did
+    size_t state_size = chip8_get_save_state_size();
+    uint8_t *halfway_state = malloc(state_size);
+    uint8_t *original_state = malloc(state_size);
+    uint8_t *restored_state = malloc(state_size);
+    static struct chip8 original, restored;
+    int failure_count = 0;
+    for (int program_index = 0; program_index < CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs); program_index++) {
+        const struct chip8_tests_program *program = &chip8_tests_programs[program_index];
+        for (int engine = CHIP8_ENGINE_INTERPRETER; engine <= CHIP8_ENGINE_THREADED; engine++) {
+            // The restored CHIP-8 starts out with another program, which loading the state must replace along with its decode cache
+            if (!chip8_tests_initialize(&original, program, 7, engine, CHIP8_QUIRKS_VIP) ||
+                !chip8_tests_initialize(&restored, &chip8_tests_programs[(program_index + 1) % CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs)], 7, engine, CHIP8_QUIRKS_VIP)) {
+                fprintf(stderr, "FAIL save_state %s: couldn't load the program\n", program->name);
+                failure_count++;
+            }
+            else {
+                int frame = 0;
+                for (; frame < CHIP8_TESTS_FRAME_COUNT / 2; frame++) {
+                    chip8_tests_tick_frame(&original, frame);
+                    chip8_tests_tick_frame(&restored, frame);
+                }
+                if (!chip8_save_state(&original, halfway_state, state_size) || !chip8_load_state(&restored, halfway_state, state_size)) {
+                    fprintf(stderr, "FAIL save_state %s: couldn't save or load the state\n", program->name);
+                    failure_count++;
+                }
+                else {
+                    for (; frame < CHIP8_TESTS_FRAME_COUNT; frame++) {
+                        chip8_tests_tick_frame(&original, frame);
+                        chip8_tests_tick_frame(&restored, frame);
+                        chip8_save_state(&original, original_state, state_size);
+                        chip8_save_state(&restored, restored_state, state_size);
+                        if (memcmp(original_state, restored_state, state_size) != 0) {
+                            fprintf(stderr, "FAIL save_state %s: engine %d, the restored state differs at frame %d\n", program->name, engine, frame);
+                            failure_count++;
+                            break;
+                        }
+                    }
+                }
+            }
+            chip8_deinitialize(&original);
+            chip8_deinitialize(&restored);
+        }
+    }
+    free(halfway_state);
+    free(original_state);
+    free(restored_state);
+    return failure_count == 0;
+}
+
+static int chip8_tests_rewind(void)
+{
+    /*
+    Records every frame into a rewind history with keyframes every 8 frames, and checks that stepping back restores the state saved at
+    that frame, both within and across keyframes, and that the program then runs on exactly as it did the first time.
+    */
+    size_t state_size = chip8_get_save_state_size();
+    uint8_t *frame_states = malloc(state_size * CHIP8_TESTS_FRAME_COUNT);
+    uint8_t *state = malloc(state_size);
+    static struct chip8 chip8;
+    static const int step_back_frame_counts[] = {1, 5, 8, 30};
+    int failure_count = 0;
+    for (int program_index = 0; program_index < CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs); program_index++) {
+        const struct chip8_tests_program *program = &chip8_tests_programs[program_index];
+        struct chip8_rewind *rewind = chip8_rewind_create(state_size * CHIP8_TESTS_FRAME_COUNT, CHIP8_TESTS_FRAME_COUNT, 8);
+        if (rewind == NULL || !chip8_tests_initialize(&chip8, program, 7, CHIP8_ENGINE_THREADED, CHIP8_QUIRKS_VIP)) {
+            fprintf(stderr, "FAIL rewind %s: couldn't create the history or load the program\n", program->name);
+            failure_count++;
+        }
+        else {
+            chip8_attach_rewind(&chip8, rewind);
+            int frame = 0;
+            for (; frame < CHIP8_TESTS_FRAME_COUNT / 2; frame++) {
+                chip8_tests_tick_frame(&chip8, frame);
+                chip8_save_state(&chip8, &frame_states[frame * state_size], state_size);
+            }
+            for (int i = 0; i < CHIP8_TESTS_ARRAY_LENGTH(step_back_frame_counts); i++) {
+                // The latest recorded frame is the one before the current frame number
+                int step_back_frame_count = step_back_frame_counts[i];
+                frame -= step_back_frame_count;
+                if (!chip8_rewind_step_back(rewind, &chip8, step_back_frame_count)) {
+                    fprintf(stderr, "FAIL rewind %s: couldn't step back %d frames\n", program->name, step_back_frame_count);
+                    failure_count++;
+                    break;
+                }
+                chip8_save_state(&chip8, state, state_size);
+                if (memcmp(state, &frame_states[(frame - 1) * state_size], state_size) != 0) {
+                    fprintf(stderr, "FAIL rewind %s: stepping back %d frames didn't restore frame %d\n", program->name, step_back_frame_count, frame - 1);
+                    failure_count++;
+                    break;
+                }
+
+                // Running again from the restored frame must reach the same states as the first time
+                int end_frame = frame + step_back_frame_count / 2;
+                for (; frame < end_frame; frame++) {
+                    chip8_tests_tick_frame(&chip8, frame);
+                    chip8_save_state(&chip8, state, state_size);
+                    if (memcmp(state, &frame_states[frame * state_size], state_size) != 0) {
+                        fprintf(stderr, "FAIL rewind %s: the state after stepping back differs at frame %d\n", program->name, frame);
+                        failure_count++;
+                        break;
+                    }
+                }
+            }
+            chip8_attach_rewind(&chip8, NULL);
+        }
+        chip8_deinitialize(&chip8);
+        chip8_rewind_destroy(rewind);
+    }
+    free(frame_states);
+    free(state);
+    return failure_count == 0;
+}
+
+static int chip8_tests_copy(void)
+{
+    /*
+    Copies a CHIP-8 by value halfway through and loads another program into the copy, which must neither change how the original runs
+    nor run the original's decoded instructions. Both are checked against CHIP-8s that never shared anything, and deinitializing both
+    must not free any page twice.
+    */
+    size_t state_size = chip8_get_save_state_size();
+    uint8_t *state = malloc(state_size);
+    uint8_t *expected_state = malloc(state_size);
+    static struct chip8 original, copy, expected_original, expected_copy;
+    int failure_count = 0;
+    for (int program_index = 0; program_index < CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs); program_index++) {
+        const struct chip8_tests_program *program = &chip8_tests_programs[program_index];
+        const struct chip8_tests_program *next_program = &chip8_tests_programs[(program_index + 1) % CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs)];
+        struct chip8_image *image = chip8_image_create(program->bytes, program->size, CHIP8_QUIRKS_VIP);
+        // Variant 2 runs the threaded engine from the program's image, so that the copy shares the image's pages as well
+        for (int variant = 0; variant < 3; variant++) {
+            enum chip8_execution_engine engine = variant == 0 ? CHIP8_ENGINE_INTERPRETER : CHIP8_ENGINE_THREADED;
+            if (image == NULL || !chip8_tests_initialize(&original, program, 7, engine, CHIP8_QUIRKS_VIP) ||
+                !chip8_tests_initialize(&expected_original, program, 7, engine, CHIP8_QUIRKS_VIP) ||
+                !chip8_tests_initialize(&expected_copy, program, 7, engine, CHIP8_QUIRKS_VIP) ||
+                (variant == 2 && (!chip8_load_image(&original, image) || !chip8_load_image(&expected_original, image)))) {
+                fprintf(stderr, "FAIL copy %s: couldn't load the program\n", program->name);
+                failure_count++;
+            }
+            else {
+                chip8_seed_random(&original, 1234);
+                chip8_seed_random(&expected_original, 1234);
+                int frame = 0;
+                for (; frame < CHIP8_TESTS_FRAME_COUNT / 2; frame++) {
+                    chip8_tests_tick_frame(&original, frame);
+                    chip8_tests_tick_frame(&expected_original, frame);
+                }
+                copy = original;
+                chip8_save_state(&original, state, state_size);
+                chip8_load_state(&expected_copy, state, state_size);
+                chip8_load_program_from_buffer(&copy, next_program->bytes, next_program->size);
+                chip8_load_program_from_buffer(&expected_copy, next_program->bytes, next_program->size);
+                for (; frame < CHIP8_TESTS_FRAME_COUNT; frame++) {
+                    chip8_tests_tick_frame(&copy, frame);
+                    chip8_tests_tick_frame(&original, frame);
+                    chip8_tests_tick_frame(&expected_copy, frame);
+                    chip8_tests_tick_frame(&expected_original, frame);
+                    chip8_save_state(&original, state, state_size);
+                    chip8_save_state(&expected_original, expected_state, state_size);
+                    bool is_original_equal = memcmp(state, expected_state, state_size) == 0;
+                    chip8_save_state(&copy, state, state_size);
+                    chip8_save_state(&expected_copy, expected_state, state_size);
+                    if (!is_original_equal || memcmp(state, expected_state, state_size) != 0) {
+                        fprintf(stderr, "FAIL copy %s: variant %d, the %s differs at frame %d\n", program->name, variant, is_original_equal ? "copy" : "original", frame);
+                        failure_count++;
+                        break;
+                    }
+                }
+                chip8_deinitialize(&copy);
+            }
+            chip8_deinitialize(&original);
+            chip8_deinitialize(&expected_original);
+            chip8_deinitialize(&expected_copy);
+        }
+        chip8_image_destroy(image);
+    }
+    free(state);
+    free(expected_state);
+    return failure_count == 0;
+}
+
+static int chip8_tests_clone(void)
+{
+    /*
+    Clones CHIP-8s loaded from an image halfway through the self-modifying program, whose writes to its code make the clone allocate its
+    own copy of the image's page. Neither the source nor the image may change, so the source must still run like a CHIP-8 that was never
+    cloned, and a CHIP-8 loaded from the image afterwards like one that loaded the program itself.
+    */
+    const struct chip8_tests_program *program = chip8_tests_find_program("self_modifying");
+    const struct chip8_tests_program *other_program = chip8_tests_find_program("alu");
+    static struct chip8 source, destination, expected_source, expected_destination;
+    size_t state_size = chip8_get_save_state_size();
+    uint8_t *state = malloc(state_size);
+    int failure_count = 0;
+    struct chip8_image *image = chip8_image_create(program->bytes, program->size, CHIP8_QUIRKS_VIP);
+    for (int engine = CHIP8_ENGINE_INTERPRETER; engine <= CHIP8_ENGINE_THREADED; engine++) {
+        if (state == NULL || image == NULL || !chip8_tests_initialize(&source, program, 7, engine, CHIP8_QUIRKS_VIP) || !chip8_load_image(&source, image) ||
+            !chip8_tests_initialize(&destination, other_program, 7, engine, CHIP8_QUIRKS_VIP) ||
+            !chip8_tests_initialize(&expected_source, program, 7, engine, CHIP8_QUIRKS_VIP) ||
+            !chip8_tests_initialize(&expected_destination, program, 7, engine, CHIP8_QUIRKS_VIP)) {
+            failure_count += chip8_tests_check(false, "clone", "couldn't load the program");
+        }
+        else {
+            chip8_seed_random(&source, 1234);
+            int frame = 0;
+            for (; frame < CHIP8_TESTS_FRAME_COUNT / 2; frame++) {
+                chip8_tests_tick_frame(&source, frame);
+                chip8_tests_tick_frame(&expected_source, frame);
+                chip8_tests_tick_frame(&destination, frame);
+            }
+            chip8_clone(&destination, &source);
+            chip8_save_state(&source, state, state_size);
+            chip8_load_state(&expected_destination, state, state_size);
+            failure_count += chip8_tests_check(chip8_tests_are_states_equal(&destination, &source), "clone", "the clone differs from its source");
+            for (; frame < CHIP8_TESTS_FRAME_COUNT; frame++) {
+                // Only the destination writes to its code from here on, which must not reach the source through the image
+                chip8_tests_tick_frame(&destination, frame);
+                chip8_tests_tick_frame(&expected_destination, frame);
+            }
+            for (frame = CHIP8_TESTS_FRAME_COUNT / 2; frame < CHIP8_TESTS_FRAME_COUNT; frame++) {
+                chip8_tests_tick_frame(&source, frame);
+                chip8_tests_tick_frame(&expected_source, frame);
+            }
+            failure_count += chip8_tests_check(chip8_tests_are_states_equal(&destination, &expected_destination), "clone", "the clone ran differently");
+            failure_count += chip8_tests_check(chip8_tests_are_states_equal(&source, &expected_source), "clone", "the clone changed how the source ran");
+
+            // The image must still hold the program as it was loaded
+            if (chip8_tests_initialize(&destination, program, 7, engine, CHIP8_QUIRKS_VIP) && chip8_load_image(&destination, image) &&
+                chip8_tests_initialize(&expected_destination, program, 7, engine, CHIP8_QUIRKS_VIP)) {
+                chip8_seed_random(&destination, 1234);
+                for (frame = 0; frame < CHIP8_TESTS_FRAME_COUNT; frame++) {
+                    chip8_tests_tick_frame(&destination, frame);
+                    chip8_tests_tick_frame(&expected_destination, frame);
+                }
+                failure_count += chip8_tests_check(chip8_tests_are_states_equal(&destination, &expected_destination), "clone", "the image was changed");
+            }
+        }
+        chip8_deinitialize(&source);
+        chip8_deinitialize(&destination);
+        chip8_deinitialize(&expected_source);
+        chip8_deinitialize(&expected_destination);
+    }
+    chip8_image_destroy(image);
+    free(state);
+    return failure_count == 0;
+}
+
+static int chip8_tests_debugger(void)
+{
+    /*
+    A breakpoint interrupts every frame that reaches it, before its instruction runs, and resuming runs the instruction instead of stopping
+    again. Interrupted frames are finished by the next tick, so the CHIP-8 must end up exactly where one without a debugger does.
+    */
+    static const uint8_t program[] = {0x70, 0x01, 0x71, 0x01, 0x12, 0x00};
+    static struct chip8 chip8, expected_chip8;
+    struct chip8_debugger *debugger = chip8_debugger_create();
+    int failure_count = 0;
+    if (debugger == NULL || !chip8_initialize(&chip8, 10) || !chip8_load_program_from_buffer(&chip8, program, sizeof(program)) ||
+        !chip8_initialize(&expected_chip8, 10) || !chip8_load_program_from_buffer(&expected_chip8, program, sizeof(program))) {
+        failure_count += chip8_tests_check(false, "debugger", "couldn't load the program");
+    }
+    else {
+        chip8_debugger_set_breakpoint(debugger, 0x202, true);
+        chip8_attach_debugger(&chip8, debugger);
+        int frame_count = 0;
+        while (frame_count < 5) {
+            int result = chip8_tick_frame(&chip8);
+            if (result == CHIP8_TICK_BREAK) {
+                const struct chip8_break *last_break = chip8_debugger_get_break(debugger);
+                failure_count += chip8_tests_check(last_break->reason == CHIP8_BREAK_BREAKPOINT && last_break->address == 0x202, "debugger", "the break isn't the breakpoint");
+                failure_count += chip8_tests_check(chip8.program_counter == 0x202 && chip8.registers[0] == chip8.registers[1] + 1, "debugger", "the breakpoint didn't stop before its instruction");
+            }
+            else if (chip8_tests_check(result == 1, "debugger", "a frame failed")) {
+                failure_count++;
+                break;
+            }
+            else {
+                frame_count++;
+            }
+        }
+        for (int i = 0; i < frame_count; i++) {
+            chip8_tick_frame(&expected_chip8);
+        }
+        failure_count += chip8_tests_check(chip8_tests_are_states_equal(&chip8, &expected_chip8), "debugger", "resuming from breakpoints changed how the program ran");
+
+        // A register watchpoint stops right after the instruction that changed the register
+        chip8_debugger_clear(debugger);
+        chip8_debugger_watch_register(debugger, 1, true);
+        const struct chip8_break *last_break = chip8_debugger_get_break(debugger);
+        failure_count += chip8_tests_check(chip8_tick_frame(&chip8) == CHIP8_TICK_BREAK && last_break->reason == CHIP8_BREAK_REGISTER_WATCHPOINT &&
+            last_break->address == 0x202 && last_break->register_index == 1 && chip8.program_counter == 0x204, "debugger", "the register watchpoint didn't stop after 7101");
+        chip8_debugger_clear(debugger);
+        failure_count += chip8_tests_check(chip8_tick_frame(&chip8) == 1, "debugger", "the interrupted frame wasn't finished");
+
+        // A memory watchpoint stops after the FX55 that overwrites the watched instruction
+        const struct chip8_tests_program *self_modifying_program = chip8_tests_find_program("self_modifying");
+        chip8_load_program_from_buffer(&chip8, self_modifying_program->bytes, self_modifying_program->size);
+        chip8.program_counter = 0x200;
+        chip8_debugger_watch_memory(debugger, 0x20D, 1, true);
+        failure_count += chip8_tests_check(chip8_tick_frame(&chip8) == CHIP8_TICK_BREAK && last_break->reason == CHIP8_BREAK_MEMORY_WATCHPOINT &&
+            last_break->address == 0x208 && last_break->memory_address == 0x20D, "debugger", "the memory watchpoint didn't stop after F155");
+    }
+    chip8_attach_debugger(&chip8, NULL);
+    chip8_deinitialize(&chip8);
+    chip8_deinitialize(&expected_chip8);
+    chip8_debugger_destroy(debugger);
+    return failure_count == 0;
+}
+
+static int chip8_tests_movie(void)
+{
+    /*
+    Records the keyboard of every frame into a movie, saves and loads it, and replays it into a freshly reset CHIP-8, which must reach
+    the recorded CHIP-8's state. The keyboard changes every few frames, and the random seed differs from the default.
+    */
+    char file_path[1024];
+    chip8_tests_get_file_path(file_path, sizeof(file_path), "c8m");
+    static struct chip8 recorded, replayed;
+    int failure_count = 0;
+    for (int program_index = 0; program_index < CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs); program_index++) {
+        const struct chip8_tests_program *program = &chip8_tests_programs[program_index];
+        struct chip8_movie *movie = chip8_movie_create(CHIP8_TESTS_FRAME_COUNT);
+        struct chip8_movie *loaded_movie = NULL;
+        if (movie == NULL || !chip8_tests_initialize(&recorded, program, 7, CHIP8_ENGINE_THREADED, CHIP8_QUIRKS_VIP) ||
+            !chip8_initialize_with_options(&replayed, &(struct chip8_options){.instructions_per_frame = 7, .execution_engine = CHIP8_ENGINE_THREADED})) {
+            failure_count += chip8_tests_check(false, "movie", "couldn't create the movie or load the program");
+        }
+        else {
+            chip8_seed_random(&recorded, 0xC8 + program_index);
+            chip8_reset(&recorded);
+            chip8_load_program_from_buffer(&recorded, program->bytes, program->size);
+            chip8_attach_movie(&recorded, movie);
+            for (int frame = 0; frame < CHIP8_TESTS_FRAME_COUNT; frame++) {
+                chip8_set_keyboard_state(&recorded, (uint16_t)(frame / 3 * 0x9E37));
+                chip8_tick_frame(&recorded);
+            }
+            chip8_attach_movie(&recorded, NULL);
+            loaded_movie = chip8_movie_save(movie, file_path) ? chip8_movie_load(file_path) : NULL;
+            remove(file_path);
+            if (loaded_movie == NULL) {
+                failure_count += chip8_tests_check(false, "movie", "couldn't save or load the movie");
+            }
+            else {
+                failure_count += chip8_tests_check(chip8_movie_get_frame_count(loaded_movie) == CHIP8_TESTS_FRAME_COUNT &&
+                    chip8_movie_get_seed(loaded_movie) == 0xC8u + program_index, "movie", "the loaded movie's frames or seed differ");
+                chip8_seed_random(&replayed, chip8_movie_get_seed(loaded_movie));
+                chip8_reset(&replayed);
+                chip8_load_program_from_buffer(&replayed, program->bytes, program->size);
+                chip8_run_frames(&replayed, loaded_movie, CHIP8_TESTS_FRAME_COUNT + 1);
+                failure_count += chip8_tests_check(chip8_movie_get_position(loaded_movie) == CHIP8_TESTS_FRAME_COUNT &&
+                    chip8_tests_are_states_equal(&replayed, &recorded), "movie", program->name);
+            }
+        }
+        chip8_movie_destroy(movie);
+        chip8_movie_destroy(loaded_movie);
+        chip8_deinitialize(&recorded);
+        chip8_deinitialize(&replayed);
+    }
+    return failure_count == 0;
+}
+
+static int chip8_tests_run_until(void)
+{
+    /*
+    Drives chip8_run_until with a clock that advances 1 millisecond at a time for 1 second, which must tick exactly 61 frames, one for
+    each 60th of a second including the first, and spread 610 instructions per second evenly across them. Then checks that catching up
+    is split into bursts, and that falling far behind skips frames.
+    */
+    static const uint8_t program[] = {0x60, 0x01, 0xF0, 0x1E, 0x12, 0x02};  // Increments I every 2 instructions
+    static struct chip8 chip8;
+    const uint64_t start_time = 5000000000;
+    int failure_count = 0;
+    if (!chip8_initialize(&chip8, 1) || !chip8_load_program_from_buffer(&chip8, program, sizeof(program)) || !chip8_set_instructions_per_second(&chip8, 610)) {
+        return chip8_tests_check(false, "run_until", "couldn't load the program") == 0;
+    }
+
+    int frame_count = 0;
+    struct chip8_run_report report;
+    for (uint64_t time = start_time; time <= start_time + 1000000000; time += 1000000) {
+        chip8_run_until(&chip8, time, &report);
+        failure_count += chip8_tests_check(report.frame_count <= 1 && report.skipped_frame_count == 0, "run_until", "a frame was ticked early or late");
+        frame_count += report.frame_count;
+        if (frame_count == 60 && report.frame_count == 1) {
+            failure_count += chip8_tests_check(chip8.index_register == 305, "run_until", "the first 60 frames didn't run 610 instructions");
+        }
+    }
+    failure_count += chip8_tests_check(frame_count == 61, "run_until", "one second didn't tick 61 frames");
+
+    // 10 frames are due once frame 70 starts, which are caught up on in bursts of CHIP8_SCHEDULE_MAXIMUM_BURST_FRAMES
+    uint64_t time = start_time + (70 * 1000000000ULL + 59) / 60;
+    int burst_frame_counts[3];
+    for (int i = 0; i < CHIP8_TESTS_ARRAY_LENGTH(burst_frame_counts); i++) {
+        chip8_run_until(&chip8, time, &report);
+        burst_frame_counts[i] = report.frame_count;
+    }
+    failure_count += chip8_tests_check(burst_frame_counts[0] == CHIP8_SCHEDULE_MAXIMUM_BURST_FRAMES && burst_frame_counts[1] == CHIP8_SCHEDULE_MAXIMUM_BURST_FRAMES &&
+        burst_frame_counts[2] == 10 - 2 * CHIP8_SCHEDULE_MAXIMUM_BURST_FRAMES, "run_until", "catching up on 10 frames wasn't split into bursts");
+
+    // Falling 100 frames behind skips all but one burst of them
+    time = start_time + (170 * 1000000000ULL + 59) / 60;
+    chip8_run_until(&chip8, time, &report);
+    failure_count += chip8_tests_check(report.frame_count == CHIP8_SCHEDULE_MAXIMUM_BURST_FRAMES && report.skipped_frame_count == 100 - CHIP8_SCHEDULE_MAXIMUM_BURST_FRAMES,
+        "run_until", "falling 100 frames behind didn't skip frames");
+    chip8_run_until(&chip8, time, &report);
+    failure_count += chip8_tests_check(report.frame_count == 0, "run_until", "skipped frames were ticked later");
+
+    // A new timeline starts after resetting the schedule, however long emulation was paused
+    chip8_reset_schedule(&chip8);
+    chip8_run_until(&chip8, time + 3600 * 1000000000ULL, &report);
+    failure_count += chip8_tests_check(report.frame_count == 1 && report.skipped_frame_count == 0, "run_until", "resetting the schedule didn't start a new timeline");
+    chip8_deinitialize(&chip8);
+    return failure_count == 0;
+}
+
+struct chip8_tests_callback_counts {
+    int display_changed_count;
+    uint32_t dirty_rows;
+    int sound_start_count;
+    int sound_stop_count;
+    int key_wait_count;
+    int key_wait_register_index;
+    int invalid_instruction_count;
+    uint16_t invalid_instruction_address;
+};
+
+static void chip8_tests_on_display_changed(struct chip8 *chip8, uint32_t dirty_rows, void *user_data)
+{
+    struct chip8_tests_callback_counts *counts = user_data;
+    counts->display_changed_count++;
+    counts->dirty_rows |= dirty_rows;
+}
+
+static void chip8_tests_on_sound_start(struct chip8 *chip8, void *user_data)
+{
+    ((struct chip8_tests_callback_counts *)user_data)->sound_start_count++;
+}
+
+static void chip8_tests_on_sound_stop(struct chip8 *chip8, void *user_data)
+{
+    ((struct chip8_tests_callback_counts *)user_data)->sound_stop_count++;
+}
+
+static void chip8_tests_on_key_wait(struct chip8 *chip8, int register_index, void *user_data)
+{
+    struct chip8_tests_callback_counts *counts = user_data;
+    counts->key_wait_count++;
+    counts->key_wait_register_index = register_index;
+}
+
+static void chip8_tests_on_invalid_instruction(struct chip8 *chip8, uint16_t address, uint16_t instruction, void *user_data)
+{
+    struct chip8_tests_callback_counts *counts = user_data;
+    counts->invalid_instruction_count++;
+    counts->invalid_instruction_address = address;
+}
+
+static int chip8_tests_callbacks(void)
+{
+    /*
+    Draws the font's 0 at (5, 5), plays a sound for 5 frames and waits in F10A for key 0, the value of V1. Pressing it draws the sprite
+    again, which clears it, and pressing it once more runs into an invalid instruction. Every callback must be called once per change,
+    on both engines.
+    */
+    static const uint8_t program[] = {
+        0x60, 0x05, 0xF0, 0x18, 0xD0, 0x05,
+        0xF1, 0x0A, 0xD0, 0x05,
+        0xF1, 0x0A, 0xFF, 0xFF,
+    };
+    static struct chip8 chip8;
+    int failure_count = 0;
+    for (int engine = CHIP8_ENGINE_INTERPRETER; engine <= CHIP8_ENGINE_THREADED; engine++) {
+        struct chip8_tests_callback_counts counts = {0};
+        const struct chip8_callbacks callbacks = {
+            .on_display_changed = chip8_tests_on_display_changed,
+            .on_sound_start = chip8_tests_on_sound_start,
+            .on_sound_stop = chip8_tests_on_sound_stop,
+            .on_key_wait = chip8_tests_on_key_wait,
+            .on_invalid_instruction = chip8_tests_on_invalid_instruction,
+            .user_data = &counts,
+        };
+        if (!chip8_initialize_with_options(&chip8, &(struct chip8_options){.instructions_per_frame = 7, .execution_engine = engine}) ||
+            !chip8_load_program_from_buffer(&chip8, program, sizeof(program))) {
+            failure_count += chip8_tests_check(false, "callbacks", "couldn't load the program");
+            continue;
+        }
+        chip8_set_callbacks(&chip8, &callbacks);
+        int result = 1;
+        for (int frame = 0; frame < 20; frame++) {
+            result &= chip8_tick_frame(&chip8);
+        }
+        failure_count += chip8_tests_check(counts.display_changed_count == 1 && counts.dirty_rows == 0x1F << 5, "callbacks", "the display callback wasn't called once for rows 5 to 9");
+        failure_count += chip8_tests_check(counts.sound_start_count == 1 && counts.sound_stop_count == 1, "callbacks", "the sound callbacks weren't called once each");
+        failure_count += chip8_tests_check(counts.key_wait_count == 1 && counts.key_wait_register_index == 1, "callbacks", "the key wait callback wasn't called once for V1");
+
+        // Each press lasts a frame, and F10A continues once the key is released
+        for (int press = 0; press < 2 && result == 1; press++) {
+            chip8_set_key_state(&chip8, 0x0, true);
+            result = chip8_tick_frame(&chip8);
+            chip8_set_key_state(&chip8, 0x0, false);
+            for (int frame = 0; frame < 5 && result == 1; frame++) {
+                result = chip8_tick_frame(&chip8);
+            }
+            if (press == 0) {
+                failure_count += chip8_tests_check(result == 1 && counts.display_changed_count == 2 && counts.key_wait_count == 2, "callbacks",
+                    "the display and key wait callbacks weren't called after the first key press");
+            }
+        }
+        failure_count += chip8_tests_check(result == 0 && counts.invalid_instruction_count == 1 && counts.invalid_instruction_address == 0x20C,
+            "callbacks", "the invalid instruction callback wasn't called after the second key press");
+        chip8_deinitialize(&chip8);
+    }
+    return failure_count == 0;
+}
+
+static int chip8_tests_trace(void)
+{
+    /*
+    Traces the ALU program, whose frames never end early, and checks that every executed instruction was recorded in order with the
+    registers it changed, that tracing doesn't change how the program runs, and that saving writes the records that weren't overwritten.
+    */
+    char file_path[1024];
+    chip8_tests_get_file_path(file_path, sizeof(file_path), "c8t");
+    const struct chip8_tests_program *program = chip8_tests_find_program("alu");
+    static struct chip8 chip8, expected_chip8;
+    struct chip8_trace *trace = chip8_trace_create(64);
+    int failure_count = 0;
+    if (trace == NULL || !chip8_tests_initialize(&chip8, program, 7, CHIP8_ENGINE_THREADED, CHIP8_QUIRKS_VIP) ||
+        !chip8_tests_initialize(&expected_chip8, program, 7, CHIP8_ENGINE_THREADED, CHIP8_QUIRKS_VIP)) {
+        failure_count += chip8_tests_check(false, "trace", "couldn't create the trace or load the program");
+    }
+    else {
+        chip8_attach_trace(&chip8, trace);
+        for (int frame = 0; frame < 20; frame++) {
+            chip8_tick_frame(&chip8);
+            chip8_tick_frame(&expected_chip8);
+        }
+
+        // Only the last 64 records are kept. The ALU program only jumps from its last instruction at 0x224 back to 0x208
+        for (uint64_t index = chip8_trace_get_record_count(trace) - 64; index < chip8_trace_get_record_count(trace); index++) {
+            const struct chip8_trace_record *record = chip8_trace_get_record(trace, index);
+            const struct chip8_trace_record *next_record = chip8_trace_get_record(trace, index + 1);
+            uint16_t next_address = (next_record != NULL) ? next_record->address : chip8.program_counter;
+            bool is_skip = (record->instruction & 0xF000) == 0x3000 || (record->instruction & 0xF000) == 0x4000;
+            if (chip8_tests_check(record->instruction == (chip8.memory[record->address] << 8 | chip8.memory[record->address + 1]) &&
+                (next_address == record->address + 2 || (is_skip && next_address == record->address + 4) || (record->address == 0x224 && next_address == 0x208)),
+                "trace", "a record's address or instruction is wrong")) {
+                failure_count++;
+                break;
+            }
+        }
+        const struct chip8_trace_record *last_record = chip8_trace_get_record(trace, chip8_trace_get_record_count(trace) - 1);
+        failure_count += chip8_tests_check(chip8_trace_get_record_count(trace) == 20 * 7 && chip8_trace_get_record(trace, 0) == NULL &&
+            last_record->register_x == chip8.registers[(last_record->instruction >> 8) & 0x0F] && last_record->register_f == chip8.registers[0xF] &&
+            last_record->index_register == chip8.index_register, "trace", "the record count or the last record's registers are wrong");
+        failure_count += chip8_tests_check(chip8_tests_are_states_equal(&chip8, &expected_chip8), "trace", "tracing changed how the program ran");
+
+        FILE *file = chip8_trace_save(trace, file_path) ? fopen(file_path, "rb") : NULL;
+        long file_size = -1;
+        char magic[4] = {0};
+        if (file != NULL) {
+            fread(magic, 1, sizeof(magic), file);
+            fseek(file, 0, SEEK_END);
+            file_size = ftell(file);
+            fclose(file);
+        }
+        remove(file_path);
+        failure_count += chip8_tests_check(memcmp(magic, "C8TR", 4) == 0 && file_size == 16 + 64 * CHIP8_TRACE_RECORD_SIZE, "trace", "the saved trace has the wrong size");
+    }
+    chip8_attach_trace(&chip8, NULL);
+    chip8_trace_destroy(trace);
+    chip8_deinitialize(&chip8);
+    chip8_deinitialize(&expected_chip8);
+    return failure_count == 0;
+}
+
+static int chip8_tests_analysis(void)
+{
+    // The call program is fully reachable through its calls and returns, while the self-modifying program writes to its own code
+    static struct chip8 chip8;
+    static struct chip8_analysis analysis;
+    int failure_count = 0;
+    const struct chip8_tests_program *program = chip8_tests_find_program("call");
+    if (!chip8_tests_initialize(&chip8, program, 7, CHIP8_ENGINE_THREADED, CHIP8_QUIRKS_VIP)) {
+        return chip8_tests_check(false, "analysis", "couldn't load the program") == 0;
+    }
+    failure_count += chip8_tests_check(chip8_analyze_program(&chip8, &analysis) == 1 && analysis.instruction_count == program->size / 2 &&
+        analysis.invalid_instruction_count == 0 && analysis.self_modification_hazard_count == 0, "analysis", "the call program isn't fully reachable and safe");
+    for (int address = 0x200; address < 0x200 + program->size; address += 2) {
+        failure_count += chip8_tests_check(analysis.address_flags[address] & CHIP8_ADDRESS_CODE, "analysis", "an instruction of the call program isn't code");
+    }
+    failure_count += chip8_tests_check((analysis.address_flags[0x204] & CHIP8_ADDRESS_BRANCH_TARGET) && (analysis.address_flags[0x212] & CHIP8_ADDRESS_BRANCH_TARGET),
+        "analysis", "a call or skip target isn't a branch target");
+
+    program = chip8_tests_find_program("self_modifying");
+    chip8_reset(&chip8);
+    chip8_load_program_from_buffer(&chip8, program->bytes, program->size);
+    failure_count += chip8_tests_check(chip8_analyze_program(&chip8, &analysis) == 0 && analysis.self_modification_hazard_count == 1 &&
+        (analysis.address_flags[0x208] & CHIP8_ADDRESS_SELF_MODIFYING) && (analysis.address_flags[0x20C] & CHIP8_ADDRESS_WRITTEN), "analysis", "the write to 0x20C wasn't found");
+    chip8_deinitialize(&chip8);
+    return failure_count == 0;
+}
+
+static int chip8_tests_batch(void)
+{
+    /*
+    Ticks one instance per program on 3 threads, which must run exactly like instances ticked on their own. A breakpoint on one of them
+    pauses it for the rest of the call, without affecting the others, and the next call finishes the interrupted frame.
+    */
+    int program_count = CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs);
+    struct chip8_batch *batch = chip8_batch_create(program_count, 3);
+    static struct chip8 expected_instances[CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs)];
+    struct chip8_debugger *debugger = chip8_debugger_create();
+    int failure_count = 0;
+    if (batch == NULL || debugger == NULL) {
+        failure_count += chip8_tests_check(false, "batch", "couldn't create the batch");
+    }
+    for (int i = 0; i < program_count && failure_count == 0; i++) {
+        if (!chip8_tests_initialize(chip8_batch_get_instance(batch, i), &chip8_tests_programs[i], 7, CHIP8_ENGINE_THREADED, CHIP8_QUIRKS_VIP) ||
+            !chip8_tests_initialize(&expected_instances[i], &chip8_tests_programs[i], 7, CHIP8_ENGINE_THREADED, CHIP8_QUIRKS_VIP)) {
+            failure_count += chip8_tests_check(false, "batch", "couldn't load the programs");
+        }
+    }
+    if (failure_count == 0) {
+        failure_count += chip8_tests_check(chip8_batch_tick_frames(batch, 30) == 0 && chip8_batch_get_paused_instance_count(batch) == 0, "batch", "ticking the batch failed");
+        for (int i = 0; i < program_count; i++) {
+            for (int frame = 0; frame < 30; frame++) {
+                chip8_tick_frame(&expected_instances[i]);
+            }
+            failure_count += chip8_tests_check(chip8_batch_get_result(batch, i) == 1 && chip8_tests_are_states_equal(chip8_batch_get_instance(batch, i), &expected_instances[i]),
+                "batch", chip8_tests_programs[i].name);
+        }
+
+        // The ALU program loops back to 0x208 every few frames. The instance ticked on its own stops at the same breakpoint
+        struct chip8 *paused_instance = chip8_batch_get_instance(batch, 0);
+        chip8_debugger_set_breakpoint(debugger, 0x208, true);
+        chip8_attach_debugger(paused_instance, debugger);
+        chip8_batch_tick_frames(batch, 30);
+        failure_count += chip8_tests_check(chip8_batch_get_result(batch, 0) == CHIP8_TICK_BREAK && chip8_batch_get_paused_instance_count(batch) == 1 &&
+            paused_instance->program_counter == 0x208, "batch", "the breakpoint didn't pause the instance");
+        chip8_attach_debugger(&expected_instances[0], debugger);
+        for (int frame = 0; frame < 30 && chip8_tick_frame(&expected_instances[0]) != CHIP8_TICK_BREAK; frame++) {
+        }
+        chip8_attach_debugger(&expected_instances[0], NULL);
+        failure_count += chip8_tests_check(chip8_tests_are_states_equal(paused_instance, &expected_instances[0]), "batch", "the instance was paused at the wrong time");
+        for (int i = 1; i < program_count; i++) {
+            for (int frame = 0; frame < 30; frame++) {
+                chip8_tick_frame(&expected_instances[i]);
+            }
+            failure_count += chip8_tests_check(chip8_batch_get_result(batch, i) == 1 && chip8_tests_are_states_equal(chip8_batch_get_instance(batch, i), &expected_instances[i]),
+                "batch", "the paused instance affected another instance");
+        }
+        chip8_attach_debugger(paused_instance, NULL);
+        chip8_batch_tick_frames(batch, 1);
+        chip8_tick_frame(&expected_instances[0]);
+        failure_count += chip8_tests_check(chip8_batch_get_result(batch, 0) == 1 && chip8_tests_are_states_equal(paused_instance, &expected_instances[0]),
+            "batch", "the next call didn't finish the interrupted frame");
+    }
+    for (int i = 0; i < program_count; i++) {
+        chip8_deinitialize(&expected_instances[i]);
+    }
+    chip8_batch_destroy(batch);
+    chip8_debugger_destroy(debugger);
+    return failure_count == 0;
+}
+
+static bool chip8_tests_wait_for_runner(struct chip8_runner *runner, uint64_t frame_number)
+{
+    // Waits up to 5 seconds for the runner to publish the frame, or to stop
+    for (int i = 0; i < 500; i++) {
+        if (chip8_runner_acquire_frame(runner)->frame_number >= frame_number || !chip8_runner_is_running(runner)) {
+            return true;
+        }
+        thrd_sleep(&(struct timespec){.tv_nsec = 10000000}, NULL);
+    }
+    return false;
+}
+
+static int chip8_tests_runner(void)
+{
+    /*
+    Runs the draw program on the emulation thread for a few frames, whose published screen must match the instance's once stopped. Then
+    a breakpoint must stop the runner with the instance paused at it, and starting the runner again must resume the instance.
+    */
+    const struct chip8_tests_program *program = chip8_tests_find_program("draw");
+    static struct chip8 chip8;
+    struct chip8_debugger *debugger = chip8_debugger_create();
+    struct chip8_runner *runner = NULL;
+    int failure_count = 0;
+    if (debugger == NULL || !chip8_tests_initialize(&chip8, program, 7, CHIP8_ENGINE_THREADED, CHIP8_QUIRKS_CHIP48) || (runner = chip8_runner_create(&chip8)) == NULL) {
+        failure_count += chip8_tests_check(false, "runner", "couldn't create the runner or load the program");
+    }
+    else {
+        failure_count += chip8_tests_check(chip8_runner_start(runner) && chip8_tests_wait_for_runner(runner, 3), "runner", "the runner didn't publish 3 frames");
+        chip8_runner_stop(runner);
+        const struct chip8_runner_frame *frame = chip8_runner_acquire_frame(runner);
+        failure_count += chip8_tests_check(chip8_runner_get_result(runner) == 1 && !chip8_runner_is_running(runner) &&
+            memcmp(frame->screen_rows, chip8_get_screen_rows(&chip8), sizeof(frame->screen_rows)) == 0, "runner", "the last published frame isn't the instance's screen");
+
+        uint64_t frame_number = frame->frame_number;
+        chip8_debugger_set_breakpoint(debugger, 0x208, true);
+        chip8_attach_debugger(&chip8, debugger);
+        failure_count += chip8_tests_check(chip8_runner_start(runner) && chip8_tests_wait_for_runner(runner, UINT64_MAX) &&
+            chip8_runner_get_result(runner) == CHIP8_TICK_BREAK, "runner", "the breakpoint didn't stop the runner");
+        chip8_runner_stop(runner);
+        failure_count += chip8_tests_check(chip8.program_counter == 0x208 && chip8_debugger_get_break(debugger)->reason == CHIP8_BREAK_BREAKPOINT,
+            "runner", "the instance isn't paused at the breakpoint");
+
+        chip8_attach_debugger(&chip8, NULL);
+        failure_count += chip8_tests_check(chip8_runner_start(runner) && chip8_tests_wait_for_runner(runner, frame_number + 2) && chip8_runner_is_running(runner),
+            "runner", "the runner didn't resume after the breakpoint");
+        chip8_runner_stop(runner);
+        failure_count += chip8_tests_check(chip8_runner_get_result(runner) == 1, "runner", "the resumed runner failed");
+    }
+    chip8_runner_destroy(runner);
+    chip8_deinitialize(&chip8);
+    chip8_debugger_destroy(debugger);
+    return failure_count == 0;
+}
+
+#ifdef CHIP8_ENABLE_STATE_HASH
+static int chip8_tests_state_hash(void)
+{
+    /*
+    The state hash is updated incrementally, so it must match between the engines on every frame, survive a save state round trip into
+    a CHIP-8 that was running another program, and keep matching as both continue.
+    */
+    size_t state_size = chip8_get_save_state_size();
+    uint8_t *state = malloc(state_size);
+    static struct chip8 interpreter, threaded, restored;
+    int failure_count = 0;
+    for (int program_index = 0; program_index < CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs) && state != NULL; program_index++) {
+        const struct chip8_tests_program *program = &chip8_tests_programs[program_index];
+        if (!chip8_tests_initialize(&interpreter, program, 7, CHIP8_ENGINE_INTERPRETER, CHIP8_QUIRKS_VIP) ||
+            !chip8_tests_initialize(&threaded, program, 7, CHIP8_ENGINE_THREADED, CHIP8_QUIRKS_VIP) ||
+            !chip8_tests_initialize(&restored, &chip8_tests_programs[(program_index + 1) % CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs)], 7, CHIP8_ENGINE_THREADED, CHIP8_QUIRKS_VIP)) {
+            failure_count += chip8_tests_check(false, "state_hash", "couldn't load the program");
+        }
+        else {
+            int frame = 0;
+            for (; frame < CHIP8_TESTS_FRAME_COUNT / 2; frame++) {
+                chip8_tests_tick_frame(&interpreter, frame);
+                chip8_tests_tick_frame(&threaded, frame);
+                chip8_tests_tick_frame(&restored, frame);
+                if (chip8_tests_check(chip8_get_state_hash(&interpreter) == chip8_get_state_hash(&threaded), "state_hash", "the engines' hashes differ")) {
+                    failure_count++;
+                    break;
+                }
+            }
+            chip8_save_state(&threaded, state, state_size);
+            chip8_load_state(&restored, state, state_size);
+            failure_count += chip8_tests_check(chip8_get_state_hash(&restored) == chip8_get_state_hash(&threaded), "state_hash", program->name);
+            for (; frame < CHIP8_TESTS_FRAME_COUNT; frame++) {
+                chip8_tests_tick_frame(&threaded, frame);
+                chip8_tests_tick_frame(&restored, frame);
+            }
+            failure_count += chip8_tests_check(chip8_get_state_hash(&restored) == chip8_get_state_hash(&threaded), "state_hash", "the hashes differ after the round trip");
+        }
+        chip8_deinitialize(&interpreter);
+        chip8_deinitialize(&threaded);
+        chip8_deinitialize(&restored);
+    }
+    free(state);
+    return failure_count == 0;
+}
+#endif
+
+#ifdef CHIP8_ENABLE_PROFILING
+static int chip8_tests_profile(void)
+{
+    // Both engines must count the same executions of every handler and address, which add up to the instructions that were executed
+    static struct chip8 interpreter, threaded;
+    int failure_count = 0;
+    for (int program_index = 0; program_index < CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_programs); program_index++) {
+        const struct chip8_tests_program *program = &chip8_tests_programs[program_index];
+        if (!chip8_tests_initialize(&interpreter, program, 7, CHIP8_ENGINE_INTERPRETER, CHIP8_QUIRKS_VIP) ||
+            !chip8_tests_initialize(&threaded, program, 7, CHIP8_ENGINE_THREADED, CHIP8_QUIRKS_VIP)) {
+            failure_count += chip8_tests_check(false, "profile", "couldn't load the program");
+            continue;
+        }
+        uint64_t executed_instruction_count = 0;
+        for (int frame = 0; frame < CHIP8_TESTS_FRAME_COUNT; frame++) {
+            chip8_tests_tick_frame(&interpreter, frame);
+            chip8_tests_tick_frame(&threaded, frame);
+            executed_instruction_count += 7 - chip8_get_skipped_instruction_count(&threaded);
+        }
+        const struct chip8_profile *interpreter_profile = chip8_get_profile(&interpreter);
+        const struct chip8_profile *threaded_profile = chip8_get_profile(&threaded);
+        uint64_t handler_count_sum = 0;
+        for (int handler = 0; handler < CHIP8_HANDLER_COUNT; handler++) {
+            handler_count_sum += threaded_profile->handler_counts[handler];
+        }
+        failure_count += chip8_tests_check(memcmp(interpreter_profile->handler_counts, threaded_profile->handler_counts, sizeof(threaded_profile->handler_counts)) == 0 &&
+            memcmp(interpreter_profile->address_counts, threaded_profile->address_counts, sizeof(threaded_profile->address_counts)) == 0 &&
+            interpreter_profile->vblank_stall_count == threaded_profile->vblank_stall_count, "profile", program->name);
+        failure_count += chip8_tests_check(threaded_profile->frame_count == CHIP8_TESTS_FRAME_COUNT && handler_count_sum == executed_instruction_count,
+            "profile", "the counts don't add up to the executed instructions");
+        chip8_deinitialize(&interpreter);
+        chip8_deinitialize(&threaded);
+    }
+    return failure_count == 0;
+}
+#endif
+
+struct chip8_tests_test {
+    const char *name;
+    int (*run)(void);
+};
+
+static const struct chip8_tests_test chip8_tests_tests[] = {
+    {"engines", chip8_tests_engines},
+    {"save_state", chip8_tests_save_state},
+    {"rewind", chip8_tests_rewind},
+    {"copy", chip8_tests_copy},
+    {"clone", chip8_tests_clone},
+    {"debugger", chip8_tests_debugger},
+    {"movie", chip8_tests_movie},
+    {"run_until", chip8_tests_run_until},
+    {"callbacks", chip8_tests_callbacks},
+    {"trace", chip8_tests_trace},
+    {"analysis", chip8_tests_analysis},
+    {"batch", chip8_tests_batch},
+    {"runner", chip8_tests_runner},
+#ifdef CHIP8_ENABLE_STATE_HASH
+    {"state_hash", chip8_tests_state_hash},
+#endif
+#ifdef CHIP8_ENABLE_PROFILING
+    {"profile", chip8_tests_profile},
+#endif
+};
+
+int main(int argc, char **argv)
+{
+    int failure_count = 0;
+    int run_count = 0;
+    if (argc > 0) {
+        chip8_tests_executable_path = argv[0];
+    }
+    for (int i = 0; i < CHIP8_TESTS_ARRAY_LENGTH(chip8_tests_tests); i++) {
+        bool is_selected = argc < 2;
+        for (int argument = 1; argument < argc; argument++) {
+            is_selected |= strcmp(argv[argument], chip8_tests_tests[i].name) == 0;
+        }
+        if (!is_selected) {
+            continue;
+        }
+        run_count++;
+        if (chip8_tests_tests[i].run()) {
+            printf("PASS %s\n", chip8_tests_tests[i].name);
+        }
+        else {
+            printf("FAIL %s\n", chip8_tests_tests[i].name);
+            failure_count++;
+        }
+    }
+    if (run_count == 0) {
+        fprintf(stderr, "No test matches the given names\n");
+        return 1;
+    }
+    return failure_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <CHIP8.h>
+
+/*
+Decodes execution traces written by chip8_trace_save. The dump command disassembles every record, and the diff command compares two traces
+record by record and prints the records leading up to the first divergence.
+*/
+
+#define CHIP8_TRACE_TOOL_DEFAULT_CONTEXT 8
+
+struct chip8_trace_file {
+    uint64_t first_index;  // The index of the first record in the trace it was saved from
+    uint64_t record_count;
+    struct chip8_trace_record *records;
+};
+
+static uint64_t chip8_trace_tool_read_value(const uint8_t *bytes, int byte_count)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < byte_count; i++) {
+        value |= (uint64_t)bytes[i] << (i * 8);
+    }
+    return value;
+}
+
+static int chip8_trace_tool_load(const char *file_path, struct chip8_trace_file *trace_file)
+{
+    FILE *file = fopen(file_path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "%s: couldn't open file\n", file_path);
+        return 0;
+    }
+
+    uint8_t header[16];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, "C8TR", 4) != 0 || chip8_trace_tool_read_value(header + 4, 2) != CHIP8_TRACE_FILE_VERSION ||
+        chip8_trace_tool_read_value(header + 6, 2) != CHIP8_TRACE_RECORD_SIZE) {
+        fprintf(stderr, "%s: not a supported trace file\n", file_path);
+        fclose(file);
+        return 0;
+    }
+    trace_file->first_index = chip8_trace_tool_read_value(header + 8, 8);
+    trace_file->record_count = 0;
+    size_t record_capacity = 1024;
+    trace_file->records = malloc(record_capacity * sizeof(*trace_file->records));
+
+    uint8_t bytes[CHIP8_TRACE_RECORD_SIZE];
+    while (trace_file->records != NULL && fread(bytes, 1, sizeof(bytes), file) == sizeof(bytes)) {
+        if (trace_file->record_count == record_capacity) {
+            record_capacity *= 2;
+            struct chip8_trace_record *records = realloc(trace_file->records, record_capacity * sizeof(*trace_file->records));
+            if (records == NULL) {
+                free(trace_file->records);
+                trace_file->records = NULL;
+                break;
+            }
+            trace_file->records = records;
+        }
+        struct chip8_trace_record *record = &trace_file->records[trace_file->record_count++];
+        record->address = chip8_trace_tool_read_value(bytes, 2);
+        record->instruction = chip8_trace_tool_read_value(bytes + 2, 2);
+        record->index_register = chip8_trace_tool_read_value(bytes + 4, 2);
+        record->register_x = bytes[6];
+        record->register_f = bytes[7];
+    }
+    fclose(file);
+    if (trace_file->records == NULL) {
+        fprintf(stderr, "%s: out of memory\n", file_path);
+        return 0;
+    }
+    return 1;
+}
+
+static void chip8_trace_tool_print_record(const char *prefix, uint64_t index, const struct chip8_trace_record *record)
+{
+    char mnemonic[32];
+    chip8_disassemble(record->instruction, mnemonic, sizeof(mnemonic));
+    printf("%s%10llu  %03X  %04X  %-16s  I=%03X V%X=%02X VF=%02X\n", prefix, (unsigned long long)index, record->address, record->instruction, mnemonic,
+           record->index_register, (record->instruction >> 8) & 0x0F, record->register_x, record->register_f);
+}
+
+static bool chip8_trace_tool_are_records_equal(const struct chip8_trace_record *a, const struct chip8_trace_record *b)
+{
+    return a->address == b->address && a->instruction == b->instruction && a->index_register == b->index_register && a->register_x == b->register_x &&
+           a->register_f == b->register_f;
+}
+
+static int chip8_trace_tool_dump(const struct chip8_trace_file *trace_file)
+{
+    for (uint64_t i = 0; i < trace_file->record_count; i++) {
+        chip8_trace_tool_print_record("", trace_file->first_index + i, &trace_file->records[i]);
+    }
+    return 0;
+}
+
+static int chip8_trace_tool_diff(const struct chip8_trace_file *a, const struct chip8_trace_file *b, int context)
+{
+    // Records are compared by their index in the traces they were saved from, so traces whose oldest records were overwritten still line up
+    uint64_t first_index = (a->first_index > b->first_index) ? a->first_index : b->first_index;
+    uint64_t a_end_index = a->first_index + a->record_count;
+    uint64_t b_end_index = b->first_index + b->record_count;
+    uint64_t end_index = (a_end_index < b_end_index) ? a_end_index : b_end_index;
+    if (first_index >= end_index) {
+        printf("The traces don't overlap\n");
+        return 1;
+    }
+
+    uint64_t index = first_index;
+    while (index < end_index && chip8_trace_tool_are_records_equal(&a->records[index - a->first_index], &b->records[index - b->first_index])) {
+        index++;
+    }
+    if (index == end_index) {
+        if (a_end_index == b_end_index) {
+            printf("The traces are identical from record %llu\n", (unsigned long long)first_index);
+            return 0;
+        }
+        printf("The traces are identical from record %llu until the %s trace ends at record %llu\n", (unsigned long long)first_index,
+               (a_end_index < b_end_index) ? "first" : "second", (unsigned long long)end_index);
+        return 1;
+    }
+
+    printf("The traces diverge at record %llu\n", (unsigned long long)index);
+    uint64_t context_index = (index - first_index > (uint64_t)context) ? index - context : first_index;
+    for (; context_index < index; context_index++) {
+        chip8_trace_tool_print_record("  ", context_index, &a->records[context_index - a->first_index]);
+    }
+    chip8_trace_tool_print_record("< ", index, &a->records[index - a->first_index]);
+    chip8_trace_tool_print_record("> ", index, &b->records[index - b->first_index]);
+    return 1;
+}
+
+static void chip8_trace_tool_print_usage(const char *program_path)
+{
+    fprintf(stderr,
+            "Usage: %s dump TRACE\n"
+            "       %s diff TRACE TRACE [--context N]\n"
+            "  --context N         Records to print before the first divergence (default %d)\n"
+            "The diff command exits with 0 when the traces are identical, and with 1 when they differ\n",
+            program_path, program_path, CHIP8_TRACE_TOOL_DEFAULT_CONTEXT);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "dump") == 0) {
+        struct chip8_trace_file trace_file;
+        if (!chip8_trace_tool_load(argv[2], &trace_file)) {
+            return 2;
+        }
+        int result = chip8_trace_tool_dump(&trace_file);
+        free(trace_file.records);
+        return result;
+    }
+
+    if ((argc == 4 || (argc == 6 && strcmp(argv[4], "--context") == 0)) && strcmp(argv[1], "diff") == 0) {
+        int context = (argc == 6) ? atoi(argv[5]) : CHIP8_TRACE_TOOL_DEFAULT_CONTEXT;
+        struct chip8_trace_file first_trace_file;
+        struct chip8_trace_file second_trace_file;
+        if (context < 0 || !chip8_trace_tool_load(argv[2], &first_trace_file)) {
+            return 2;
+        }
+        if (!chip8_trace_tool_load(argv[3], &second_trace_file)) {
+            free(first_trace_file.records);
+            return 2;
+        }
+        int result = chip8_trace_tool_diff(&first_trace_file, &second_trace_file, context);
+        free(first_trace_file.records);
+        free(second_trace_file.records);
+        return result;
+    }
+
+    chip8_trace_tool_print_usage(argv[0]);
+    return 2;
+}